@@ -0,0 +1,148 @@
+#include "../tests/allocationCounter.hpp"
+#include <hcss/lexer/lexer.hpp>
+#include <hcss/parser/blockBuilder.hpp>
+#include <hcss/parser/parser.hpp>
+#include <hcss/parser/stylesheet.hpp>
+#include <hcss/util/threadPool.hpp>
+#include <sys/resource.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+/**
+ * Parses a style sheet and prints the parse time, the global allocations of one parse, the time to free the rules and
+ * the peak RSS. Without a file it parses a generated sheet of framework-like rules. Peak RSS only ever grows, so each
+ * mode runs in a process of its own:
+ *
+ *   parse heap|arena [rules|file.css] [repeats] [threads]
+ *
+ * heap parses with Parser, arena with Stylesheet. With threads, the top-level rules are resolved on a pool of that size.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * @brief A sheet of 'rules' rules that uses variables, mixins with and without parameters, nested rules, media queries
+ * @brief and the usual selector and value shapes. The same count always gives the same sheet.
+ */
+
+static std::string corpus(size_t rules) {
+    std::ostringstream out;
+
+    for (int i = 0; i < 32; i++) {
+        out << "$color-" << i << ": #" << std::hex << 0x102030 * (i + 1) % 0xFFFFFF << std::dec << ";\n";
+    }
+
+    out << "$gutter: 16px;\n$font: \"Helvetica Neue\", Arial, sans-serif;\n@tablet = screen and (min-width: 768px);\n";
+    out << "@mixin reset { margin: 0; padding: 0; border: 0; }\n";
+    out << "@mixin button($fg, $bg: white) { color: $fg; background-color: $bg; border: 1px solid $fg; }\n";
+
+    for (size_t i = 0; i < rules; i++) {
+        int k = (int) (i % 32);
+
+        switch (i % 6) {
+            case 0: out << ".card-" << i << " > .title, .card-" << i << ":hover"; break;
+            case 1: out << "#nav-" << i << " ul li a[href^=\"http\"]"; break;
+            case 2: out << ".btn-" << i << ":not(.disabled)::before"; break;
+            case 3: out << "div.grid-" << i << " + p ~ span.col-" << k; break;
+            case 4: out << "@tablet"; break;
+            default: out << "input[type=\"text\"].field-" << i; break;
+        }
+
+        if (i % 6 == 4) {
+            out << " { .hide-" << i << " { display: none !important; } }\n";
+            continue;
+        }
+
+        out << " {\n  color: $color-" << k << ";\n  padding: calc($gutter / 2) $gutter;\n";
+        out << "  font: 400 14px/1.5 $font;\n  transform: translate(" << i % 100 << "px, -50%) rotate(45deg);\n";
+        out << "  background: url(img/bg-" << i << ".png) no-repeat center / cover, rgba(0, 0, 0, 0." << k % 10 << ");\n";
+
+        if (i % 3 == 0) {
+            out << "  @include button($color-" << k << ");\n";
+        }
+        else if (i % 3 == 1) {
+            out << "  @include reset;\n";
+        }
+
+        out << "  .icon { width: " << 8 + k << "px; height: " << 8 + k << "px; margin-left: auto; }\n}\n";
+    }
+
+    return out.str();
+}
+
+static size_t peakRss() {
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t) usage.ru_maxrss / 1024;
+}
+
+int main(int argc, char** argv) {
+    std::string mode = argc > 1 ? argv[1] : "arena";
+    std::string input = argc > 2 ? argv[2] : "24000";
+    int repeats = argc > 3 ? std::stoi(argv[3]) : 5;
+    int threads = argc > 4 ? std::stoi(argv[4]) : 0;
+    std::string source;
+
+    if (input.find_first_not_of("0123456789") == std::string::npos) {
+        source = corpus(std::stoul(input));
+    }
+    else {
+        std::ifstream file(input, std::ios::binary);
+        source.assign(std::istreambuf_iterator<char>(file), {});
+    }
+
+    double best = 1e300, freeing = 0;
+    uint64_t allocations = 0;
+    size_t rules = 0;
+    std::optional<ThreadPool> pool;
+
+    if (threads > 0) {
+        pool.emplace(threads);
+    }
+
+    Stylesheet sheet(Arena::DEFAULT_BLOCK_SIZE, {}, pool ? &*pool : nullptr);
+
+    for (int i = 0; i < repeats; i++) {
+        uint64_t before = allocationCount();
+        auto start = Clock::now();
+
+        if (mode == "heap") {
+            Lexer lexer(source);
+            BlockBuilder builder;
+            lexer.lex(builder);
+            Parser parser(std::move(builder.values));
+            parser.pool = pool ? &*pool : nullptr;
+            NodeList<SyntaxNode> list = parser.parse();
+            best = std::min(best, since(start));
+            allocations = allocationCount() - before;
+            rules = list.size();
+
+            start = Clock::now();
+            NodeList<SyntaxNode>().swap(list);
+            freeing = since(start);
+        }
+        else {
+            rules = sheet.parse(source).size();
+            best = std::min(best, since(start));
+            allocations = allocationCount() - before;
+
+            start = Clock::now();
+            sheet.reset();
+            freeing = since(start);
+        }
+    }
+
+    std::cout << mode << ": " << source.size() / 1024 << " KB, " << rules << " rules, " << threads << " threads\n"
+              << "parse " << best << " ms (best of " << repeats << ")\n"
+              << "allocations " << allocations << "\n"
+              << "free " << freeing << " ms\n"
+              << "peak RSS " << peakRss() << " MB\n";
+}
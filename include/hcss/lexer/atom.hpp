@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+
+using Atom = uint32_t;
+
+// The empty name. Tokens that are not names carry it.
+enum : Atom {
+	ATOM_NONE
+};
+
+Atom internAtom(std::string_view name);
+std::string_view atomName(Atom atom);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+
+enum CharClass : unsigned char {
+	CC_SPACE = 1,
+	CC_DIGIT = 2,
+	CC_HEX = 4,
+	CC_IDENT_START = 8,
+	CC_IDENT = 16
+};
+
+/**
+ * Byte classes for the lexer, following the CSS syntax spec definitions. Bytes >= 0x80 are ident bytes, which is exact
+ * for UTF-8 input because every byte of a multi-byte sequence is non-ASCII.
+ */
+
+inline constexpr std::array<unsigned char, 256> charClasses = [] {
+	std::array<unsigned char, 256> table {};
+
+	for (int c = 0; c < 256; c++) {
+		bool digit = c >= '0' && c <= '9';
+		bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		bool identStart = letter || c >= 0x80 || c == '_';
+
+		table[c] = (c == ' ' || c == '\t' || c == '\n' ? CC_SPACE : 0)
+			| (digit ? CC_DIGIT : 0)
+			| (digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') ? CC_HEX : 0)
+			| (identStart ? CC_IDENT_START : 0)
+			| (identStart || digit || c == '-' ? CC_IDENT : 0);
+	}
+
+	return table;
+}();
+
+/**
+ * @brief Tests a byte (or EOF) against a set of CharClass bits
+ */
+
+inline bool hasClass(int c, unsigned char mask) {
+	return (unsigned) c < 256 && (charClasses[c] & mask);
+}
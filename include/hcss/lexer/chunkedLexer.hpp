@@ -0,0 +1,46 @@
+#pragma once
+
+#include "lexer.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * Push-based front end over Lexer for input that arrives in pieces (pipes, sockets). feed() lexes as far as the bytes
+ * seen so far decide, finish() flushes the rest and the T_EOF token.
+ *
+ * Tokens are handed to the sink one at a time and are only valid for the duration of the call: their lexemes point into
+ * buffers that are reused for the next chunk. A sink that keeps tokens must copy the lexemes it needs. Token offsets
+ * count from the start of the whole input, and 'lines' indexes the input seen so far.
+ */
+
+class ChunkedLexer {
+	public:
+		using Sink = std::function<void(const Token&)>;
+		ChunkedLexer(Sink sink)
+			: sink(std::move(sink))
+		{};
+		void feed(string_view chunk);
+		void finish();
+		LineIndex lines;
+	private:
+		Sink sink;
+		// Start of a token that may continue in the next chunk. Only this tail is carried over.
+		string pending;
+		// Offset of the first byte of 'pending' in the whole input
+		SourceOffset offset = 0;
+		// A comment is open across chunks. Its body is skipped as it arrives instead of being carried in 'pending'.
+		bool inComment = false;
+		bool trailingStar = false;
+		// A string or unquoted url is open across chunks. Its lexeme has to be contiguous, so 'pending' still holds all
+		// of it, but the bytes before 'scanned' are known not to end it and are not lexed again until something does.
+		enum OpenToken { OPEN_NONE, OPEN_STRING, OPEN_URL };
+		OpenToken open = OPEN_NONE;
+		char quote = 0;
+		size_t scanned = 0;
+		void run(bool final);
+		void findOpen();
+		bool stillOpen();
+		string_view skipComment(string_view chunk);
+		void advance(string_view skipped);
+};
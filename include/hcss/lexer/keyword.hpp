@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <cstdint>
+
+/**
+ * Names the parser and lexer recognise, with ASCII case folding. Tokens carry the id of their name, so special names are
+ * dispatched with a switch instead of string comparisons. The order of the units matches UnitId.
+ */
+
+enum Keyword : unsigned char {
+	KW_NONE,
+	// At-rules
+	KW_MEDIA, KW_MIXIN, KW_INCLUDE, KW_IMPORT, KW_CHARSET, KW_NAMESPACE, KW_SUPPORTS, KW_PAGE, KW_FONT_FACE,
+	KW_KEYFRAMES, KW_LAYER, KW_CONTAINER, KW_PROPERTY, KW_COUNTER_STYLE, KW_DOCUMENT, KW_VIEWPORT,
+	// Functions and values
+	KW_URL, KW_CALC, KW_VAR, KW_ENV, KW_ATTR, KW_RGB, KW_RGBA, KW_HSL, KW_HSLA, KW_MIN, KW_MAX, KW_CLAMP, KW_NOT,
+	KW_IS, KW_WHERE, KW_HAS, KW_NTH_CHILD, KW_NTH_LAST_CHILD, KW_NTH_OF_TYPE, KW_NTH_LAST_OF_TYPE, KW_LANG, KW_DIR,
+	KW_IMPORTANT, KW_INHERIT, KW_INITIAL, KW_UNSET, KW_REVERT, KW_AUTO, KW_AND, KW_OR, KW_ONLY, KW_SCREEN,
+	KW_PRINT, KW_ALL,
+	// Pseudo-classes and pseudo-elements. 'click' is the HCSS event pseudo-class.
+	KW_CLICK, KW_HOVER, KW_ACTIVE, KW_FOCUS, KW_FOCUS_WITHIN, KW_FOCUS_VISIBLE, KW_VISITED, KW_LINK, KW_CHECKED,
+	KW_DISABLED, KW_ENABLED, KW_FIRST_CHILD, KW_LAST_CHILD, KW_ONLY_CHILD, KW_FIRST_OF_TYPE, KW_LAST_OF_TYPE,
+	KW_ONLY_OF_TYPE, KW_EMPTY, KW_ROOT, KW_TARGET, KW_BEFORE, KW_AFTER, KW_FIRST_LINE, KW_FIRST_LETTER, KW_SELECTION,
+	KW_PLACEHOLDER,
+	// Properties
+	KW_COLOR, KW_BACKGROUND, KW_BACKGROUND_COLOR, KW_BORDER, KW_BORDER_RADIUS, KW_MARGIN, KW_PADDING, KW_WIDTH,
+	KW_HEIGHT, KW_MIN_WIDTH, KW_MAX_WIDTH, KW_MIN_HEIGHT, KW_MAX_HEIGHT, KW_DISPLAY, KW_POSITION, KW_TOP, KW_RIGHT,
+	KW_BOTTOM, KW_LEFT, KW_FLOAT, KW_CLEAR, KW_OVERFLOW, KW_VISIBILITY, KW_OPACITY, KW_Z_INDEX, KW_FONT, KW_FONT_SIZE,
+	KW_FONT_FAMILY, KW_FONT_WEIGHT, KW_LINE_HEIGHT, KW_TEXT_ALIGN, KW_CONTENT, KW_CURSOR, KW_BOX_SIZING, KW_TRANSFORM,
+	KW_TRANSITION, KW_FLEX, KW_GRID,
+	// Units, in UnitId order
+	KW_PX, KW_EM, KW_REM, KW_EX, KW_CH, KW_VW, KW_VH, KW_VMIN, KW_VMAX, KW_CM, KW_MM, KW_Q, KW_IN, KW_PT, KW_PC,
+	KW_DEG, KW_GRAD, KW_RAD, KW_TURN, KW_S, KW_MS, KW_HZ, KW_KHZ, KW_DPI, KW_DPCM, KW_DPPX, KW_X, KW_FR,
+	KW_COUNT
+};
+
+inline constexpr std::array<std::string_view, KW_COUNT> keywordNames = {
+	"",
+	"media", "mixin", "include", "import", "charset", "namespace", "supports", "page", "font-face", "keyframes",
+	"layer", "container", "property", "counter-style", "document", "viewport",
+	"url", "calc", "var", "env", "attr", "rgb", "rgba", "hsl", "hsla", "min", "max", "clamp", "not", "is", "where",
+	"has", "nth-child", "nth-last-child", "nth-of-type", "nth-last-of-type", "lang", "dir", "important", "inherit",
+	"initial", "unset", "revert", "auto", "and", "or", "only", "screen", "print", "all",
+	"click", "hover", "active", "focus", "focus-within", "focus-visible", "visited", "link", "checked", "disabled",
+	"enabled", "first-child", "last-child", "only-child", "first-of-type", "last-of-type", "only-of-type", "empty",
+	"root", "target", "before", "after", "first-line", "first-letter", "selection", "placeholder",
+	"color", "background", "background-color", "border", "border-radius", "margin", "padding", "width", "height",
+	"min-width", "max-width", "min-height", "max-height", "display", "position", "top", "right", "bottom", "left",
+	"float", "clear", "overflow", "visibility", "opacity", "z-index", "font", "font-size", "font-family",
+	"font-weight", "line-height", "text-align", "content", "cursor", "box-sizing", "transform", "transition", "flex",
+	"grid",
+	"px", "em", "rem", "ex", "ch", "vw", "vh", "vmin", "vmax", "cm", "mm", "q", "in", "pt", "pc", "deg", "grad", "rad",
+	"turn", "s", "ms", "hz", "khz", "dpi", "dpcm", "dppx", "x", "fr",
+};
+
+namespace keyword_detail {
+	constexpr unsigned char fold(char c) {
+		return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+	}
+
+	constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+		uint32_t h = 2166136261u ^ seed;
+
+		for (char c : name) {
+			h = (h ^ fold(c)) * 16777619u;
+		}
+
+		return h ^ (h >> 15);
+	}
+
+	constexpr std::size_t TABLE_SIZE = 2048;
+
+	constexpr std::size_t maxLength = [] {
+		std::size_t length = 0;
+
+		for (auto name : keywordNames) {
+			length = name.size() > length ? name.size() : length;
+		}
+
+		return length;
+	}();
+
+	struct Table {
+		uint32_t seed;
+		std::array<Keyword, TABLE_SIZE> slots;
+	};
+
+	// Searches for a seed that maps every keyword to its own slot
+	constexpr Table table = [] {
+		for (uint32_t seed = 0;; seed++) {
+			Table result { seed, {} };
+			bool collision = false;
+
+			for (int id = 1; id < KW_COUNT && !collision; id++) {
+				Keyword& slot = result.slots[hash(keywordNames[id], seed) & (TABLE_SIZE - 1)];
+				collision = slot != KW_NONE;
+				slot = (Keyword) id;
+			}
+
+			if (!collision) {
+				return result;
+			}
+		}
+	}();
+}
+
+/**
+ * @brief Gets the keyword id of a name, ignoring ASCII case
+ *
+ * @return Keyword The id, or KW_NONE if the name is not a keyword
+ */
+
+constexpr Keyword keywordId(std::string_view name) {
+	using namespace keyword_detail;
+
+	if (name.empty() || name.size() > maxLength) {
+		return KW_NONE;
+	}
+
+	Keyword id = table.slots[hash(name, table.seed) & (TABLE_SIZE - 1)];
+	std::string_view candidate = keywordNames[id];
+
+	if (candidate.size() != name.size()) {
+		return KW_NONE;
+	}
+
+	for (std::size_t i = 0; i < name.size(); i++) {
+		if (fold(name[i]) != candidate[i]) {
+			return KW_NONE;
+		}
+	}
+
+	return id;
+}
+
+static_assert(keywordId("MeDiA") == KW_MEDIA && keywordId("px") == KW_PX && keywordId("mediaa") == KW_NONE);
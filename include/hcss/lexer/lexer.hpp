@@ -2,39 +2,71 @@
 
 #include "token.hpp"
 #include "tokenType.hpp"
+#include "scan.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
-#include <fstream>
+#include <deque>
+#include <istream>
 #include <tuple>
 using std::string;
+using std::string_view;
 using std::vector;
+using std::deque;
 using std::tuple;
-using std::wstring;
-
-#define COLUMN ((int) reader.tellg() - posOffset)
 
 class Lexer {
+	friend class ChunkedLexer;
+	friend class ParallelLexer;
+	friend class StreamingParser;
 	public:
 		vector<Token> tokens;
+		LineIndex lines;
+		// Whether names are interned as they are lexed. Without it a name is only interned once Token::atom() is read,
+		// so names that are never looked up do not stay in the atom table.
+		bool internNames = true;
 		vector<Token>& lex();
-		Lexer(std::istream& stream)
-			: reader(stream)
+		TokenStream& lex(TokenStream& stream);
+		void lex(TokenSink& sink);
+		Lexer(const char* begin, const char* end)
+			: begin(begin), pos(begin), end(end)
+		{};
+		Lexer(string_view source)
+			: Lexer(source.data(), source.data() + source.size())
 		{};
+		Lexer(std::istream& stream);
+		Lexer(const Lexer&) = delete;
+		Lexer& operator=(const Lexer&) = delete;
 	private:
-		std::istream& reader;
-		int posOffset = 0, line = 1;
-        wchar_t current{};
+		string buffer;
+		deque<string> storage;
+		TokenStream* stream = nullptr;
+		TokenSink* sink = nullptr;
+		const char* begin;
+		const char* pos;
+		const char* end;
+		const char* mark = nullptr;
+		const ScanKernels& scan = scanKernels();
+		// Offset of 'begin' in the whole input, for input that is lexed in pieces
+		SourceOffset offsetBase = 0;
+		SourceOffset offsetOf(const char* p) const { return offsetBase + (SourceOffset) (p - begin); }
+		void lexToken();
+		int peek(int offset = 0) const;
+		void newline(const char* at);
+		void newlines(const char* from, const char* to);
+		string& own(const char* from, const char* to);
+		void emit(Token&& t);
 		void addToken(TokenType type);
+		void addToken(TokenType type, string_view lexeme);
 		void consumeWhitespace();
-        wchar_t consumeEscapedCodePoint();
+		void consumeComment();
+		char32_t consumeEscapedCodePoint();
 		void consumeString();
-		wstring consumeIdent();
+		string_view consumeIdent();
 		void consumeHash();
 		bool isIdentSequence();
-		tuple<wstring, wstring> consumeNumber();
 		void consumeNumericToken();
 		void consumeIdentLike();
 		void consumeUrl();
 		void consumeBadUrl();
-		void skipSpace();
-};
\ No newline at end of file
+};
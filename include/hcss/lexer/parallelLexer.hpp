@@ -0,0 +1,40 @@
+#pragma once
+
+#include "lexer.hpp"
+#include <hcss/util/threadPool.hpp>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+/**
+ * Lexes a contiguous buffer in chunks on a thread pool. The buffer is split just after a '}' from the StructuralIndex,
+ * which lies outside strings, comments, url(...) and escapes, so every chunk starts on a token boundary of the serial lexer.
+ * Each chunk's tokens are checked to end exactly on the next split before they are stitched, and a chunk that fails the
+ * check is lexed again from where its predecessor stopped. 'tokens' and 'lines' are therefore identical to what
+ * Lexer::lex() produces for the same buffer.
+ *
+ * Lexemes point into the buffer or into the chunk lexers, so the tokens must not outlive the ParallelLexer.
+ */
+
+class ParallelLexer {
+	public:
+		vector<Token> tokens;
+		LineIndex lines;
+		vector<Token>& lex();
+		ParallelLexer(const char* begin, const char* end, ThreadPool& pool = ThreadPool::shared())
+			: begin(begin), end(end), pool(pool)
+		{};
+		ParallelLexer(string_view source, ThreadPool& pool = ThreadPool::shared())
+			: ParallelLexer(source.data(), source.data() + source.size(), pool)
+		{};
+		ParallelLexer(const ParallelLexer&) = delete;
+		ParallelLexer& operator=(const ParallelLexer&) = delete;
+	private:
+		const char* begin;
+		const char* end;
+		ThreadPool& pool;
+		// One per chunk, kept alive for the lexemes they own
+		deque<Lexer> lexers;
+		vector<const char*> splitPoints(size_t chunks) const;
+		Lexer& lexChunk(const char* from, const char* to);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "sourceLocation.hpp"
+#include <cstddef>
+#include <vector>
+
+enum ScanLevel {
+	SCAN_SCALAR,
+	SCAN_SSE2,
+	SCAN_AVX2
+};
+
+/**
+ * Bulk scanning kernels used by the lexer's hot loops. Every kernel takes a [p, end) range and returns the first position
+ * that stops the run (or 'end'), so callers never need a terminator after the buffer.
+ */
+
+struct ScanKernels {
+	ScanLevel level;
+	// First byte that is not ' ', '\t' or '\n'
+	const char* (*skipWhitespace)(const char* p, const char* end);
+	// First byte that is not an ident code point
+	const char* (*skipIdent)(const char* p, const char* end);
+	// Position of the closing "*/" of a comment
+	const char* (*findCommentEnd)(const char* p, const char* end);
+	// First 'quote', '\\' or '\n'
+	const char* (*findStringStop)(const char* p, const char* end, char quote);
+	// First byte that ends the plain part of an unquoted url: ')', whitespace, quotes, '(' or '\\'
+	const char* (*findUrlStop)(const char* p, const char* end);
+	// Appends the offset of the byte after every '\n' in [p, end) to 'starts', where 'base' is the offset of p
+	void (*recordNewlines)(const char* p, const char* end, SourceOffset base, std::vector<SourceOffset>& starts);
+	// Appends the offset of every '{', '}', '[', ']', '(', ')', ';' and ',' to 'out' up to the first '"', '\'', '\\' or
+	// '/', which the caller has to look at, and returns that position
+	const char* (*recordStructurals)(const char* p, const char* end, SourceOffset base, std::vector<SourceOffset>& out);
+};
+
+const ScanKernels& scanKernels();
+const ScanKernels& scanKernels(ScanLevel level);
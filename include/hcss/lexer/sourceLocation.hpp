@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+// Byte offset into the source. Define HCSS_LARGE_FILES for inputs of 4 GiB or more.
+#ifdef HCSS_LARGE_FILES
+using SourceOffset = uint64_t;
+#else
+using SourceOffset = uint32_t;
+#endif
+
+// Offset of tokens that do not come from the source (e.g tokens the parser synthesises)
+inline constexpr SourceOffset NO_SOURCE_OFFSET = std::numeric_limits<SourceOffset>::max();
+
+struct SourceLocation {
+	// 1-based
+	int64_t line;
+	// 0-based, in bytes from the start of the line
+	int64_t column;
+};
+
+/**
+ * Offsets of the first byte of every line, in ascending order. The lexer fills it as it crosses newlines, and line and
+ * column numbers are only worked out from it when a diagnostic needs them.
+ *
+ * An index can also cover just a window of the input: starts.front() is then the offset of the window's first line and
+ * firstLine its number.
+ */
+
+struct LineIndex {
+	std::vector<SourceOffset> starts { 0 };
+	int64_t firstLine = 1;
+	SourceLocation locate(SourceOffset offset) const;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "sourceLocation.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+using std::string_view;
+using std::vector;
+
+/**
+ * Positions of the structural bytes '{', '}', '[', ']', '(', ')', ';' and ',' that lie outside strings, comments,
+ * escapes and unquoted url(...) tokens, built in one SIMD pass without tokenizing. Brackets are paired the way the
+ * parser nests blocks: a closer only matches the innermost open bracket of its kind, anything else is left unmatched.
+ *
+ * This lets a caller find where a rule or block ends without consuming it, e.g. to skip a rule or to hand top-level rules
+ * to different threads. '(' covers the opening of a function as well. The index reads the buffer it was built over, so
+ * it must not outlive it.
+ */
+
+class StructuralIndex {
+	public:
+		static constexpr SourceOffset NO_MATCH = NO_SOURCE_OFFSET;
+		// Offsets of the structural bytes in input order
+		vector<SourceOffset> offsets;
+		// For a bracket, the index of its partner in 'offsets'. NO_MATCH for unclosed brackets, ';' and ','.
+		vector<SourceOffset> matches;
+		StructuralIndex(const char* begin, const char* end);
+		StructuralIndex(string_view source)
+			: StructuralIndex(source.data(), source.data() + source.size())
+		{};
+		size_t size() const { return offsets.size(); }
+		char at(size_t i) const { return begin[offsets[i]]; }
+		size_t find(SourceOffset offset) const;
+		size_t ruleEnd(size_t i) const;
+	private:
+		const char* begin;
+		void matchBrackets();
+};
+
+/**
+ * @brief Tests whether the '(' at 'paren' ends a bare "url" ident, so that the lexer reads a url token unless a quote
+ * @brief follows. Idents written with escapes are not recognised.
+ */
+
+bool isUrlParen(const char* begin, const char* paren);
@@ -1,20 +1,85 @@
 #pragma once
 
 #include "tokenType.hpp"
+#include "unit.hpp"
+#include "atom.hpp"
+#include "keyword.hpp"
+#include "sourceLocation.hpp"
 #include <string>
-#include <map>
-using std::wstring;
+#include <string_view>
+#include <vector>
+#include <cstdint>
 using std::string;
+using std::string_view;
+
+enum TokenFlag : unsigned char {
+	// HASH: the name would start an ident sequence (an id selector candidate)
+	TF_ID = 1,
+	// NUMBER, PERCENTAGE, DIMENSION: the representation has a fraction or exponent
+	TF_NUMBER = 2
+};
+
+/**
+ * Lexemes are UTF-8 and borrowed: they point into the Lexer's source buffer, or into storage owned by the Lexer when
+ * escapes had to be decoded. Tokens must not outlive the Lexer that produced them.
+ */
 
 struct Token {
+	string_view lexeme;
+	// Byte offset of the token in the source. LineIndex::locate turns it into a line and column.
+	SourceOffset offset;
 	TokenType type;
-	wstring lexeme;
-	int line, column;
-	std::map<string, wstring> flags;
-	Token(TokenType type, const wstring& lexeme = {}, int column = -1, int line = -1)
-		: type(type),
-		lexeme(lexeme),
-		column(column - (int) lexeme.length()),
-		line(line)
-	{};
-};
\ No newline at end of file
+	// STRING: the quote character that delimited it
+	char quote = '\0';
+	unsigned char flags = 0;
+	// IDENT, FUNCTION, AT_KEYWORD, HASH: the keyword id of the name
+	Keyword keyword = KW_NONE;
+	// DIMENSION: the interned unit
+	UnitId unit = UNIT_NONE;
+	// NUMBER, PERCENTAGE, DIMENSION: the parsed value. 'integer' is set when isInteger(), 'number' otherwise.
+	// IDENT, FUNCTION, AT_KEYWORD, HASH: 'atom' is the interned name, set by the constructor unless 'intern' is false.
+	// Read it through atom().
+	union {
+		double number;
+		int64_t integer;
+		Atom atom;
+	} value {};
+	Token(TokenType type, string_view lexeme = {}, SourceOffset offset = NO_SOURCE_OFFSET, bool intern = true)
+		: lexeme(lexeme),
+		offset(offset),
+		type(type)
+	{
+		if (isName()) {
+			value.atom = intern ? internAtom(lexeme) : ATOM_NONE;
+			keyword = keywordId(lexeme);
+		}
+	};
+	bool isName() const { return type == IDENT || type == FUNCTION || type == AT_KEYWORD || type == HASH; }
+	// The interned name of a name token, interned now if the constructor left it out
+	Atom atom() const { return value.atom != ATOM_NONE ? value.atom : internAtom(lexeme); }
+	bool isId() const { return flags & TF_ID; }
+	bool isInteger() const { return !(flags & TF_NUMBER); }
+	double numeric() const { return isInteger() ? (double) value.integer : value.number; }
+};
+
+/**
+ * Structure-of-arrays form of a token stream, for passes that only look at token types and source extents. offsets and
+ * lengths describe the token's bytes in the source buffer, so escaped lexemes are not decoded here.
+ */
+
+struct TokenStream {
+	std::vector<TokenType> types;
+	std::vector<SourceOffset> offsets;
+	std::vector<SourceOffset> lengths;
+	std::size_t size() const { return types.size(); }
+};
+
+/**
+ * Receives tokens from Lexer::lex(TokenSink&) as they are produced, so a consumer can build its own structure without a
+ * token vector in between.
+ */
+
+struct TokenSink {
+	virtual void push(Token&& t) = 0;
+	virtual ~TokenSink() = default;
+};
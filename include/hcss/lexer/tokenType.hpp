@@ -1,6 +1,6 @@
 #pragma once
 
-enum TokenType {
+enum TokenType : unsigned char {
 	IDENT,
 	FUNCTION,
 	AT_KEYWORD,
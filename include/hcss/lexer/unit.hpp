@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+
+using UnitId = uint16_t;
+
+// Units known up front get stable ids, anything else is interned on first sight
+enum : UnitId {
+	UNIT_NONE,
+	UNIT_PX, UNIT_EM, UNIT_REM, UNIT_EX, UNIT_CH, UNIT_VW, UNIT_VH, UNIT_VMIN, UNIT_VMAX,
+	UNIT_CM, UNIT_MM, UNIT_Q, UNIT_IN, UNIT_PT, UNIT_PC,
+	UNIT_DEG, UNIT_GRAD, UNIT_RAD, UNIT_TURN,
+	UNIT_S, UNIT_MS, UNIT_HZ, UNIT_KHZ,
+	UNIT_DPI, UNIT_DPCM, UNIT_DPPX, UNIT_X,
+	UNIT_FR,
+	UNIT_FIRST_INTERNED
+};
+
+UnitId internUnit(std::string_view name);
+std::string_view unitName(UnitId id);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "grammar/atRule.hpp"
+#include "grammar/function.hpp"
+#include "grammar/qualifiedRule.hpp"
+#include "grammar/simpleBlock.hpp"
+#include "grammar/styleRule.hpp"
+#include "types.hpp"
+#include <hcss/lexer/token.hpp>
+#include <optional>
+#include <vector>
+using std::vector;
+
+/**
+ * Builds the component value tree while the lexer runs. Brackets are matched as tokens arrive: {, [ and ( open a
+ * SimpleBlock and a FUNCTION token opens a FunctionCall whose arguments are split at its top-level commas. Parentheses
+ * inside a function stay flat tokens, the same as Parser::consumeCommaList leaves them. Unclosed nodes are closed at
+ * EOF.
+ *
+ * Nodes that contain a '$' are marked unwalked and the parser expands them like a flat token list. Every other node is
+ * already in the shape the parser would build and is taken as is.
+ */
+
+class BlockBuilder : public TokenSink {
+    public:
+        NodeList<ComponentValue> values;
+        void push(Token&& t) override;
+    private:
+        struct Frame {
+            // The opening token ({, [, ( or FUNCTION)
+            Token open;
+            // Where the node's contents start in 'pending'
+            size_t start;
+            // Where each argument after the first starts in 'pending', for functions
+            vector<size_t> commas = {};
+            // Depth of flat parentheses inside a function
+            int parens = 0;
+            bool unwalked = false;
+        };
+        vector<Frame> frames;
+        // Contents of every open node, innermost last. Closed nodes are moved out into exactly sized vectors.
+        NodeList<ComponentValue> pending;
+        void append(ComponentValue&& value);
+        void close(std::optional<Token> token);
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types.hpp"
+#include "grammar/atRule.hpp"
+#include "grammar/function.hpp"
+#include "grammar/qualifiedRule.hpp"
+#include "grammar/simpleBlock.hpp"
+#include "grammar/selector.hpp"
+#include "grammar/styleBlock.hpp"
+#include "grammar/styleRule.hpp"
+
+/**
+ * Deep copies of syntax tree nodes. The node types are move-only so that the parser cannot copy a subtree by accident;
+ * these are for the places that really need a second copy, like expanding a variable or a mixin that is used again
+ * later. Copies come from the current Arena, like any other node.
+ */
+
+ComponentValue clone(const ComponentValue& value);
+NodeList<ComponentValue> clone(const NodeList<ComponentValue>& values);
+SyntaxNode clone(const SyntaxNode& node);
+StyleBlockVariant clone(const StyleBlockVariant& item);
+StyleBlock clone(const StyleBlock& block);
+SimpleBlock clone(const SimpleBlock& block);
+FunctionCall clone(const FunctionCall& call);
+FunctionDefinition clone(const FunctionDefinition& function);
+AtRule clone(const AtRule& rule);
+QualifiedRule clone(const QualifiedRule& rule);
+StyleRule clone(const StyleRule& rule);
+Declaration clone(const Declaration& declaration);
+PseudoClassSelector clone(const PseudoClassSelector& selector);
+CompoundSelector clone(const CompoundSelector& selector);
+ComplexSelector clone(const ComplexSelector& selector);
+ComplexSelectorList clone(const ComplexSelectorList& selectors);
+// How many values clone() copies for 'values', counting those nested in them
+size_t countNodes(const NodeList<ComponentValue>& values);
@@ -5,7 +5,8 @@
 #include <utility>
 #include <vector>
 #include <variant>
-#include <deque>
+#include <algorithm>
+#include <iterator>
 #include "grammar/atRule.hpp"
 #include "grammar/function.hpp"
 #include "grammar/qualifiedRule.hpp"
@@ -15,35 +16,81 @@
 #include "grammar/styleRule.hpp"
 #include "types.hpp"
 using std::vector;
-using std::deque;
 
 #define SYNTAX_ERROR(s, t) throw SyntaxError(s, t, __LINE__, __FILE__)
 
+/**
+ * Supplies a parser with more values while it runs, for input that is still being lexed. The parser only pulls when
+ * it runs out of values.
+ */
+
+struct ValueSource {
+    // Appends the next batch to 'values', blocking until one is ready. Returns false once the input is exhausted.
+    virtual bool pull(NodeList<ComponentValue>& values) = 0;
+    virtual ~ValueSource() = default;
+};
+
+/**
+ * Reads component values through a cursor over a contiguous buffer. peek() hands out pointers into the buffer instead of
+ * copies, consuming moves a value out and advances the cursor, and expansions are written into the consumed slots in
+ * front of the cursor. A parser owns its buffer: sub-parsers are given the vector they parse by move when the caller is
+ * done with it.
+ *
+ * Pointers from peek() stay valid until the next prepend(), or the next more(), peek() or check() that has to pull from
+ * 'source'.
+ */
+
 struct ComponentValueParser {
-    ComponentValueParser(vector<ComponentValue> vec)
-    {
-        std::move(vec.begin(), vec.end(), std::back_inserter(values));
-    };
-    ComponentValueParser(deque<ComponentValue> values)
+    ComponentValueParser(NodeList<ComponentValue> values)
         : values(std::move(values))
     {};
     ComponentValueParser(const vector<Token>& tokens)
-    {
-        std::move(tokens.begin(), tokens.end(), std::back_inserter(values));
-    };
-    deque<ComponentValue> values;
+        : values(tokens.begin(), tokens.end())
+    {};
+    // values[pos] is the next value. Everything before it has been consumed.
+    NodeList<ComponentValue> values;
+    size_t pos = 0;
+    // How far the values have moved in 'values' since parsing began, so position() stays put when the buffer shifts
+    int64_t shift = 0;
+    // Where more values come from once 'values' runs out, nullptr if 'values' is the whole input
+    ValueSource* source = nullptr;
+    size_t remaining() const { return values.size() - pos; }
+    // The cursor as an index that stays valid across prepends and pulls. Values not consumed yet keep theirs.
+    int64_t position() const { return (int64_t) pos - shift; }
+    bool more() { return pos < values.size() || fill(1); }
+    bool fill(size_t count);
+    ComponentValue& front() { return values[pos]; }
+    void skip() { pos++; }
+    void prepend(ComponentValue&& value);
+    template<typename It> void prepend(It first, It last);
     ComponentValue consume();
     template<typename T = ComponentValue> T consume();
     Token consume(TokenType type, const string& error);
-    optional<ComponentValue> peek(int idx = 0);
-    template<typename T = ComponentValue> optional<T> peek(int idx = 0);
+    ComponentValue* peek(size_t idx = 0);
+    template<typename T> T* peek(size_t idx = 0);
     template<typename T = ComponentValue> bool check();
-    bool check(TokenType type, int idx = 0);
-    bool check(const wstring& lexeme, int idx = 0);
-    bool check(const wchar_t& lexeme, int idx = 0);
+    bool check(TokenType type, size_t idx = 0);
+    bool check(string_view lexeme, size_t idx = 0);
+    bool check(char lexeme, size_t idx = 0);
     TokenType mirror(TokenType type);
+    private:
+        void reserveFront(size_t count);
 };
 
+/**
+ * @brief Puts values back in front of the cursor, e.g the expansion of a variable
+ *
+ * @param first, last The values to insert. Pass move iterators to move them.
+ */
+
+template<typename It>
+void ComponentValueParser::prepend(It first, It last) {
+    size_t count = std::distance(first, last);
+    reserveFront(count);
+    pos -= count;
+    std::copy(first, last, values.begin() + pos);
+}
+
 /**
  * @brief Consumes the next SyntaxNode of type T
  * 
@@ -54,10 +101,13 @@ struct ComponentValueParser {
 
 template<typename T>
 T ComponentValueParser::consume() {
-    if (auto val = std::get_if<T>(&values.front())) {
-        auto temp = std::move(*val);
-        values.pop_front();
-        return temp;
+    if (!more()) {
+        SYNTAX_ERROR("Unexpected end of input", nullopt);
+    }
+
+    if (auto val = std::get_if<T>(&values[pos])) {
+        pos++;
+        return std::move(*val);
     }
     else {
         SYNTAX_ERROR(string("Called consume method with an invalid type. The specified type (") + string(typeid(T).name()).substr(1) + ") does not match the next token's type.", nullopt);
@@ -65,20 +115,17 @@ T ComponentValueParser::consume() {
 }
 
 /**
- * @brief Peeks the next SyntaxNode of type T
+ * @brief Peeks the next SyntaxNode of type T without copying it
  * 
  * @tparam T The more specific type of the SyntaxNode (e.g Token, SimpleBlock, etc.)
- * @return SyntaxNode of type T on success
- * @return nullopt on failure
+ * @return T* The value in the buffer on success
+ * @return nullptr on failure
  */
 
 template<typename T>
-optional<T> ComponentValueParser::peek(int idx) {
-    if (values.empty() || idx > values.size()) return nullopt;
-    if (const T* val = std::get_if<T>(&values[idx])) {
-        return *val;
-    }
-    return nullopt;
+T* ComponentValueParser::peek(size_t idx) {
+    if (idx >= remaining() && !fill(idx + 1)) return nullptr;
+    return std::get_if<T>(&values[pos + idx]);
 }
 
 /**
@@ -90,5 +137,5 @@ optional<T> ComponentValueParser::peek(int idx) {
 
 template<typename T>
 bool ComponentValueParser::check() {
-    return peek<T>().has_value();
-}
\ No newline at end of file
+    return more() && std::holds_alternative<T>(values[pos]);
+}
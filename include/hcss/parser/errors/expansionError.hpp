@@ -0,0 +1,15 @@
+#pragma once
+
+#include "syntaxError.hpp"
+
+#define EXPANSION_ERROR(s, t) throw ExpansionError(s, t, __LINE__, __FILE__)
+
+/**
+ * Thrown when a sheet runs over its ExpansionLimits or includes a mixin inside itself. Unlike other syntax errors it is
+ * never recovered from, so a parse that catches SyntaxError to try another way has to let it through.
+ */
+
+class ExpansionError : public SyntaxError {
+    public:
+        using SyntaxError::SyntaxError;
+};
@@ -1,28 +1,51 @@
 #pragma once
 
 #include <hcss/lexer/token.hpp>
-#include <locale>
-#include <codecvt>
+#include <hcss/lexer/sourceLocation.hpp>
 #include <optional>
 
 using std::to_string;
 
-inline std::string wstring_convert(const std::wstring& wstr) {
-    std::size_t len = std::wcstombs(nullptr, wstr.c_str(), 0) + 1;
-    char* buffer = new char[len];
-    std::wcstombs(buffer, wstr.c_str(), len);
-    std::string result(buffer);
-    delete[] buffer;
-    return result;
-}
+/**
+ * Tokens only carry a byte offset, so the error starts out with the offset of the offending token. Call locate() with
+ * the lexer's LineIndex to work out the line and column and put them in the message.
+ */
 
 class SyntaxError : public std::exception {
     public:
         string error;
+        SourceOffset offset = NO_SOURCE_OFFSET;
+        std::optional<SourceLocation> location;
         SyntaxError(const string& error, std::optional<Token> tok = std::nullopt, int line = -1, const string& file = "NULL")
-            : error((tok ? "\nSyntax Error:\nLine: " + to_string(tok->line) + "\nColumn: " + to_string(tok->column) + "\nLexeme: " + wstring_convert(tok->lexeme) + "\nType: " + to_string(tok->type) + "\nDetails: " + error : "\nSyntax Error:\nDetails: " + error) + "\nThrown At:\nLine: " + to_string(line) + "\nFile: " + file)
+            : details(error), thrownLine(line), file(file)
+        {
+            if (tok) {
+                offset = tok->offset;
+                lexeme = string(tok->lexeme);
+                type = tok->type;
+            }
+
+            format();
+        };
+        SyntaxError(const string& error, const Token* tok, int line = -1, const string& file = "NULL")
+            : SyntaxError(error, tok ? std::optional<Token>(*tok) : std::nullopt, line, file)
         {};
+        SourceLocation locate(const LineIndex& lines) {
+            location = lines.locate(offset);
+            format();
+            return *location;
+        }
         [[nodiscard]] const char* what() const noexcept override {
             return error.c_str();
         }
+    private:
+        string details, lexeme;
+        // The offending token's type, -1 if there is no token
+        int type = -1;
+        int thrownLine;
+        string file;
+        void format() {
+            string position = location ? "Line: " + to_string(location->line) + "\nColumn: " + to_string(location->column) : "Offset: " + to_string(offset);
+            error = (type != -1 ? "\nSyntax Error:\n" + position + "\nLexeme: " + lexeme + "\nType: " + to_string(type) + "\nDetails: " + details : "\nSyntax Error:\nDetails: " + details) + "\nThrown At:\nLine: " + to_string(thrownLine) + "\nFile: " + file;
+        }
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "types.hpp"
+#include "grammar/atRule.hpp"
+#include "grammar/function.hpp"
+#include "grammar/qualifiedRule.hpp"
+#include "grammar/simpleBlock.hpp"
+#include "grammar/styleRule.hpp"
+#include <hcss/lexer/token.hpp>
+#include <cstdint>
+#include <vector>
+
+enum FlatKind : uint8_t {
+    FK_TOKEN,
+    // token: the opening bracket. The closing one is the last child, if there was one.
+    FK_BLOCK,
+    // token: the FUNCTION token. Children are FK_ARGUMENTs.
+    FK_FUNCTION,
+    FK_ARGUMENT,
+    // token: the AT_KEYWORD. Children are an FK_PRELUDE and the FK_BLOCK, if any.
+    FK_AT_RULE,
+    // Children are an FK_PRELUDE and the FK_BLOCK, if any
+    FK_QUALIFIED_RULE,
+    FK_PRELUDE,
+    // Children are the FK_COMPLEX_SELECTORs followed by the items of the style block
+    FK_STYLE_RULE,
+    // token: the property name. Children are the value.
+    FK_DECLARATION,
+    // Children are FK_COMPOUND_SELECTORs with an FK_COMBINATOR between two of them when there is one
+    FK_COMPLEX_SELECTOR,
+    // token: the combinator ('>', '+', '~' or the first '|' of '||', whose second '|' is the next token)
+    FK_COMBINATOR,
+    // Children are the type selector, subclass selectors and pseudo-elements in source order
+    FK_COMPOUND_SELECTOR,
+    // Children are the tokens of the name, e.g 'svg', '|', 'rect'
+    FK_TYPE_SELECTOR,
+    // token: the HASH token
+    FK_ID_SELECTOR,
+    // token: the class name
+    FK_CLASS_SELECTOR,
+    // Children are the tokens between the brackets
+    FK_ATTRIBUTE_SELECTOR,
+    // token: the IDENT or FUNCTION token. Children are the arguments of a functional pseudo-class.
+    FK_PSEUDO_CLASS,
+    // Like FK_PSEUDO_CLASS. The pseudo-classes that follow it in the compound selector are its next siblings.
+    FK_PSEUDO_ELEMENT
+};
+
+enum FlatFlag : uint8_t {
+    // FK_DECLARATION: marked !important
+    FF_IMPORTANT = 1
+};
+
+/**
+ * A node of a FlatTree. Nodes point at each other and at their token by index, so a node is 16 bytes instead of a
+ * variant of structs that each hold a Token.
+ */
+
+struct FlatNode {
+    static constexpr uint32_t NONE = UINT32_MAX;
+    FlatKind kind;
+    unsigned char flags = 0;
+    // Index in FlatTree::tokens, NONE for nodes that have no token of their own
+    uint32_t token = NONE;
+    uint32_t firstChild = NONE;
+    uint32_t nextSibling = NONE;
+};
+
+/**
+ * The syntax tree as one array of nodes in pre-order, with the tokens in a second array in the same order. A pass over
+ * the whole sheet is a forward walk over 'nodes', and 'tokens' on its own is the sheet's tokens in source order. The
+ * top-level rules are node 0 and its next siblings.
+ *
+ * Token lexemes still point wherever the parser's did, so the tree must not outlive the source or Lexer of the rules it
+ * was built from.
+ */
+
+class FlatTree {
+    public:
+        vector<FlatNode> nodes;
+        vector<Token> tokens;
+        FlatTree() = default;
+        explicit FlatTree(const NodeList<SyntaxNode>& rules);
+        const Token* token(uint32_t node) const;
+    private:
+        // Links the children of 'parent' as they are added
+        struct Siblings {
+            FlatTree& tree;
+            uint32_t parent;
+            uint32_t last = FlatNode::NONE;
+            void push(uint32_t child);
+        };
+        uint32_t append(FlatKind kind, const Token* token = nullptr);
+        uint32_t add(const SyntaxNode& node);
+        uint32_t add(const ComponentValue& value);
+        uint32_t add(const StyleBlockVariant& item);
+        uint32_t add(const Token& t);
+        uint32_t add(const SimpleBlock& block);
+        uint32_t add(const FunctionCall& call);
+        uint32_t add(const AtRule& rule);
+        uint32_t add(const QualifiedRule& rule);
+        uint32_t add(const StyleRule& rule);
+        uint32_t add(const Declaration& declaration);
+        uint32_t add(const ComplexSelector& selector);
+        uint32_t add(const CompoundSelector& selector);
+        uint32_t add(const TypeSelector& selector);
+        uint32_t add(const AttributeSelector& selector);
+        uint32_t add(const PseudoClassSelector& selector, FlatKind kind = FK_PSEUDO_CLASS);
+        uint32_t addPrelude(const NodeList<ComponentValue>& prelude);
+        void addNsPrefix(Siblings& siblings, const NsPrefix& prefix);
+        void addWqName(Siblings& siblings, const WqName& name);
+};
@@ -8,6 +8,11 @@
 
 struct AtRule {
     Token name;
-    std::vector<ComponentValue> prelude;
+    NodeList<ComponentValue> prelude;
     std::optional<SimpleBlock> block;
+    explicit AtRule(Token name, NodeList<ComponentValue> prelude = {}, std::optional<SimpleBlock> block = std::nullopt)
+        : name(std::move(name)), prelude(std::move(prelude)), block(std::move(block))
+    {};
+    AtRule(AtRule&&) = default;
+    AtRule& operator=(AtRule&&) = default;
 };
\ No newline at end of file
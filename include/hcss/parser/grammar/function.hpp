@@ -4,12 +4,27 @@
 #include <utility>
 #include <vector>
 
+// Most calls have a few arguments. Each is a NodeList, so they fit inline without making ComponentValue any larger.
+using ArgumentList = SmallVector<NodeList<ComponentValue>, 4>;
+
 struct FunctionCall {
     Token name;
-    std::vector<std::vector<ComponentValue>> arguments;
+    ArgumentList arguments;
+    // Set by BlockBuilder when the arguments hold variables that the parser has not expanded yet
+    bool unwalked = false;
+    FunctionCall(Token name, ArgumentList arguments = {}, bool unwalked = false)
+        : name(std::move(name)), arguments(std::move(arguments)), unwalked(unwalked)
+    {};
+    FunctionCall(FunctionCall&&) = default;
+    FunctionCall& operator=(FunctionCall&&) = default;
 };
 
 struct FunctionDefinition {
     Token name;
-    std::vector<std::pair<wstring, std::vector<ComponentValue>>> parameters = {};
+    NodeList<std::pair<Atom, NodeList<ComponentValue>>> parameters = {};
+    explicit FunctionDefinition(Token name)
+        : name(std::move(name))
+    {};
+    FunctionDefinition(FunctionDefinition&&) = default;
+    FunctionDefinition& operator=(FunctionDefinition&&) = default;
 };
\ No newline at end of file
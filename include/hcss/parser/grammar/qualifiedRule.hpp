@@ -7,6 +7,12 @@
 #include <optional>
 
 struct QualifiedRule {
-    std::vector<ComponentValue> prelude;
+    NodeList<ComponentValue> prelude;
     std::optional<SimpleBlock> block;
+    QualifiedRule() = default;
+    QualifiedRule(NodeList<ComponentValue> prelude, std::optional<SimpleBlock> block)
+        : prelude(std::move(prelude)), block(std::move(block))
+    {};
+    QualifiedRule(QualifiedRule&&) = default;
+    QualifiedRule& operator=(QualifiedRule&&) = default;
 };
\ No newline at end of file
@@ -88,7 +88,7 @@ struct ClassSelector {
 struct PseudoClassSelector {
     Token colon;
     Token tok;
-    optional<vector<ComponentValue>> anyValue;
+    optional<NodeList<ComponentValue>> anyValue;
     optional<Token> closeParen;
 };
 
@@ -108,15 +108,15 @@ struct PseudoElementSelector {
 [ <type-selector>? <subclass-selector>*
     [ <pseudo-element-selector> <pseudo-class-selector>* ]* ]!
 */
-using PseudoSelectorPair = pair<PseudoElementSelector, vector<PseudoClassSelector>>;
+using PseudoSelectorPair = pair<PseudoElementSelector, NodeList<PseudoClassSelector>>;
 struct CompoundSelector {
     optional<TypeSelector> typeSelector;
-    vector<SubclassSelector> subclassSelectors;
-    vector<PseudoSelectorPair> pseudoSelectors;
+    NodeList<SubclassSelector> subclassSelectors;
+    NodeList<PseudoSelectorPair> pseudoSelectors;
 };
 
 // <compound-selector> [ <combinator>? <compound-selector> ]*
-using ComplexSelector = vector<pair<Combinator, CompoundSelector>>;
+using ComplexSelector = NodeList<pair<Combinator, CompoundSelector>>;
 
 // <combinator>? <complex-selector>
 struct RelativeSelector {
@@ -124,4 +124,4 @@ struct RelativeSelector {
     ComplexSelector selector;
 };
 
-using ComplexSelectorList = vector<ComplexSelector>;
\ No newline at end of file
+using ComplexSelectorList = NodeList<ComplexSelector>;
\ No newline at end of file
@@ -8,6 +8,13 @@ using std::move;
 
 struct SimpleBlock {
     Token open;
-    std::vector<ComponentValue> value = {};
+    NodeList<ComponentValue> value = {};
     std::optional<Token> close;
+    // Set by BlockBuilder when the contents hold variables that the parser has not expanded yet
+    bool unwalked = false;
+    explicit SimpleBlock(Token open, NodeList<ComponentValue> value = {}, std::optional<Token> close = std::nullopt, bool unwalked = false)
+        : open(std::move(open)), value(std::move(value)), close(std::move(close)), unwalked(unwalked)
+    {};
+    SimpleBlock(SimpleBlock&&) = default;
+    SimpleBlock& operator=(SimpleBlock&&) = default;
 };
\ No newline at end of file
@@ -1,17 +1,25 @@
 #pragma once
 
 #include "../types.hpp"
+#include "atRule.hpp"
+#include "function.hpp"
+#include "qualifiedRule.hpp"
+#include "simpleBlock.hpp"
+#include "styleRule.hpp"
 #include <utility>
 #include <vector>
 #include <variant>
-class StyleRule;
 
 struct Declaration {
     Token name;
     Token colon;
-    std::vector<ComponentValue> value;
-    bool important;
-};
-
-using StyleBlockVariant = std::variant<std::monostate, Declaration, AtRule, QualifiedRule, StyleRule>;
-using StyleBlock = std::vector<StyleBlockVariant>;
\ No newline at end of file
+    // Most values are one or two component values, which stay inline. That needs ComponentValue to be complete, hence
+    // the includes above.
+    SmallVector<ComponentValue, 2> value;
+    bool important = false;
+    Declaration(Token name, Token colon, SmallVector<ComponentValue, 2> value = {}, bool important = false)
+        : name(std::move(name)), colon(std::move(colon)), value(std::move(value)), important(important)
+    {};
+    Declaration(Declaration&&) = default;
+    Declaration& operator=(Declaration&&) = default;
+};
\ No newline at end of file
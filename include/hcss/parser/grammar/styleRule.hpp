@@ -3,9 +3,18 @@
 #include <utility>
 
 #include "selector.hpp"
-#include "styleBlock.hpp"
+#include "../types.hpp"
 
 struct StyleRule {
     ComplexSelectorList selectors;
     StyleBlock block;
-};
\ No newline at end of file
+    explicit StyleRule(ComplexSelectorList selectors, StyleBlock block = {})
+        : selectors(std::move(selectors)), block(std::move(block))
+    {};
+    StyleRule(StyleRule&&) = default;
+    StyleRule& operator=(StyleRule&&) = default;
+};
+
+// Declaration holds ComponentValues inline, so it can only be defined once StyleRule is. Anything that has a StyleRule
+// needs it to be complete as well.
+#include "styleBlock.hpp"
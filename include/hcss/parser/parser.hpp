@@ -1,44 +1,315 @@
 #pragma once
 
 #include "componentValueParser.hpp"
+#include "clone.hpp"
 #include "types.hpp"
-#include <map>
+#include "errors/expansionError.hpp"
+#include <hcss/util/threadPool.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Caps on the work one compilation may do. Expansions copy values and style block items that are not in the
+ * @brief source, so a small sheet could otherwise grow without bound. 0 turns a cap off.
+ */
+
+typedef struct ExpansionLimits {
+    // Values copied in by variables, at-rule aliases and mixins included by name, counting the values nested in functions
+    // and blocks. Each copy may stay in the tree, so this also bounds the memory expansions take, a few hundred bytes a
+    // value. A generated sheet of 24000 rules copies about 200000.
+    uint64_t tokens = 1 << 20;
+    // Style block items built. An included mixin body counts its top-level items, not those of the rules nested in it.
+    uint64_t nodes = 1 << 24;
+    // Mixins being included inside each other
+    uint32_t depth = 64;
+    // Wall time from the start of parse(). The clock is only read when values are expanded or style block items are
+    // built, every 64th time, so this does not stop a parse that spends its time elsewhere, e.g lexing a huge sheet.
+    uint64_t milliseconds = 0;
+} ExpansionLimits;
+
+/**
+ * @brief What one compilation has spent of its ExpansionLimits. The parser of the sheet starts it and hands it to every
+ * @brief parser it starts for a block or a mixin body, so nested parsers draw from the same budget. The counters are
+ * @brief atomic, since rules may be parsed on several threads at once.
+ */
+
+typedef struct ExpansionBudget {
+    ExpansionLimits limits;
+    std::atomic<uint64_t> tokens = 0;
+    std::atomic<uint64_t> nodes = 0;
+    explicit ExpansionBudget(const ExpansionLimits& limits);
+    void spend(size_t count, const Token* at);
+    void build(size_t count, const Token* at);
+    private:
+        std::chrono::steady_clock::time_point deadline;
+        // Calls since the clock was last read
+        std::atomic<uint32_t> ticks = 0;
+        void tick(const Token* at);
+} ExpansionBudget;
+
+/**
+ * @brief How many includes of a mixin with arguments copied an instance built before, and how many had to build one
+ */
+
+typedef struct IncludeStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+} IncludeStats;
+
+/**
+ * @brief Keeps values past the input they were parsed from, for a parser that frees its input as it goes. Their lexemes
+ * @brief are copied into storage of its own, so the values no longer point into the input.
+ */
+
+struct ValueStore {
+    virtual void keep(Token& token) = 0;
+    virtual void keep(NodeList<ComponentValue>& values) = 0;
+    virtual ~ValueStore() = default;
+};
+
+/**
+ * @brief A mixin's parameters and walked body. The first @include also parses the body into style block items, which
+ * @brief later includes copy instead of parsing the tokens again.
+ */
 
 typedef struct Mixin {
     optional<FunctionDefinition> function;
-    vector<ComponentValue> value = {};
+    NodeList<ComponentValue> value = {};
+    // The parsed body, with each parameter reference left as a '$' and its name for the include to fill in. Empty if the
+    // body parses differently depending on where it is included, in which case each include parses 'value' itself.
+    optional<StyleBlock> body;
+    // Whether 'body' has been worked out yet
+    bool compiled = false;
+    // Instances keyed by the values of the parameters. A key seen once maps to nullopt, so the instance is only kept
+    // once the same values come again.
+    std::unordered_map<std::string, optional<StyleBlock>> instances;
+    IncludeStats stats;
+    // Keeps the arguments of the instances, so they outlive the input of the @include. nullptr if the input lives as long
+    // as the mixin.
+    ValueStore* store = nullptr;
 } Mixin;
 
+/**
+ * @brief The value of a variable or at-rule alias. It is parsed once where it is defined, and a reference inside a list
+ * @brief copies it straight into the list unless parsing it again at the cursor could come out differently.
+ */
+
+typedef struct Variable {
+    NodeList<ComponentValue> values;
+    // False if the values hold something that could end or regroup the list they are parsed into: ';', EOF, a lone
+    // bracket, a '{' block, an unwalked node or a '$' (a parameter reference)
+    bool flat = true;
+    // Whether there is a top-level comma, which splits the arguments of a function call
+    bool commas = false;
+    // countNodes() of the values, what an expansion is charged
+    size_t nodes = 0;
+    explicit Variable(NodeList<ComponentValue> values);
+} Variable;
+
+/**
+ * @brief The definitions of one kind (variables, mixins, ...) made in a Scope. Each name maps to its innermost
+ * @brief definition, which links to the one it hides, so a lookup is one hash probe however deeply blocks are nested.
+ */
+
+template<typename T>
+class Bindings {
+    public:
+        struct Binding {
+            Atom name;
+            // Block depth the definition was made at
+            uint32_t depth;
+            // Index of the definition of 'name' that this one hides, NONE if there is none
+            uint32_t shadowed;
+            T value;
+        };
+        static constexpr uint32_t NONE = UINT32_MAX;
+        T* find(Atom name);
+        void define(Atom name, uint32_t depth, T value);
+        void drop(uint32_t depth);
+        typename std::vector<Binding>::iterator begin() { return entries.begin(); }
+        typename std::vector<Binding>::iterator end() { return entries.end(); }
+    private:
+        // In the order they were made, so the definitions of the innermost block are always at the back
+        std::vector<Binding> entries;
+        // Keyed by the atom of the name
+        std::unordered_map<Atom, uint32_t> innermost;
+};
+
+/**
+ * @brief The definitions visible at the cursor. Entering a block only bumps 'depth' and leaving it drops what the block
+ * @brief defined, so nothing is copied per block. Pointers from the find functions are valid until the next definition.
+ */
+
 typedef struct Scope {
-    Scope* parent;
-    std::map<wstring, vector<ComponentValue>> variables, atRules;
-    std::map<wstring, Mixin> mixins;
-    std::vector<wstring> parameters;
-    vector<ComponentValue>* findVariable(const wstring& name);
-    vector<ComponentValue>* findAtRule(const wstring& name);
-    Mixin* findMixin(const wstring& name);
-    bool isParameter(const wstring& name);
+    // The scope of the parser this one's input came from, e.g the sheet's for the parser of a style block
+    Scope* parent = nullptr;
+    uint32_t depth = 0;
+    Bindings<Variable> variables, atRules;
+    Bindings<Mixin> mixins;
+    Bindings<std::monostate> parameters;
+    void push();
+    void pop();
+    void defineVariable(Atom name, NodeList<ComponentValue> value);
+    void defineAtRule(Atom name, NodeList<ComponentValue> value);
+    void defineMixin(Atom name, Mixin mixin);
+    void addParameter(Atom name);
+    void clearParameters();
+    Variable* findVariable(Atom name);
+    Variable* findAtRule(Atom name);
+    Mixin* findMixin(Atom name);
+    bool isParameter(Atom name);
+    Scope snapshot();
 } Scope;
 
 class Parser : public ComponentValueParser {
     public:
-        vector<SyntaxNode> parse();
+        NodeList<SyntaxNode> parse();
         using ComponentValueParser::ComponentValueParser;
 
         virtual optional<AtRule> consumeAtRule();
         void consumeMixin();
-        vector<vector<ComponentValue>> consumeCommaList();
+        ArgumentList consumeCommaList();
         FunctionDefinition consumeFunctionDefinition();
         FunctionCall consumeFunctionCall();
         QualifiedRule consumeQualifiedRule();
         SimpleBlock consumeSimpleBlock();
         ComponentValue consumeComponentValue();
-        void consumeComponentValue(vector<ComponentValue>& vec);
-        vector<SyntaxNode> consumeRulesList();
-        vector<ComponentValue> consumeValueList();
+        template<typename List>
+        void consumeComponentValue(List& list, bool arguments = false);
+        NodeList<SyntaxNode> consumeRulesList();
+        bool consumeRule(NodeList<SyntaxNode>& list);
+        NodeList<ComponentValue> consumeValueList();
         bool consumeVariable();
+        IncludeStats includeStats();
+        // Used when this parser starts the budget, i.e when no other parser started it
+        ExpansionLimits limits;
+        // When set, parse() parses the selectors and style blocks of the top-level rules on it. Must not be called from a
+        // job on the same pool.
+        ThreadPool* pool = nullptr;
+        // Needed for 'pool' while an Arena is current, since an arena is only used by one thread. Each job resolves copies
+        // of its rules in an arena of its own, added here as needed, so these must outlive the rules. Not needed for a
+        // sheet too small to be worth the pool, which parse() resolves on its own thread.
+        std::deque<Arena>* arenas = nullptr;
     protected:
-        vector<SyntaxNode> rules;
-        Scope scope = {};
+        // Keeps what this parser defines in its scope, and the instances of its mixins, when the input does not outlive
+        // the parser
+        ValueStore* store = nullptr;
+        // The values a mixin included by name was put back as, up to the position 'end'
+        struct Region {
+            Atom mixin;
+            int64_t end;
+            // Whether the region below comes right after this one, from the same @include, and has not started yet
+            bool before;
+        };
+        NodeList<SyntaxNode> rules;
+        Scope scope;
         bool top = true;
-};
\ No newline at end of file
+        // How many references to a parameter have been left in place for the mixin body being walked
+        uint32_t parameterReferences = 0;
+        // Innermost last. Regions the cursor has left are dropped by the next expand().
+        SmallVector<Region, 4> regions;
+        // The parser that started this one, and its position() where the rule or @include that did so began
+        Parser* caller = nullptr;
+        int64_t callStart = 0;
+        ExpansionBudget& budget();
+        void spend(size_t count, const Token* at) { budget().spend(count, at); }
+        void build(size_t count, const Token* at) { budget().build(count, at); }
+        void enter(Parser& child, int64_t start, const Token* mixin = nullptr);
+        void expand(const Token& name, int64_t start);
+        // Counts of the scopes parse() copied for other threads, see includeStats()
+        IncludeStats resolved;
+        void resolve(SyntaxNode& node, Scope& visible);
+        void resolveParallel();
+        bool checkUnwalked();
+        void unwrap(SimpleBlock&& block);
+        void unwrap(FunctionCall&& call);
+        const Variable* consumeReference(bool arguments);
+    private:
+        ExpansionBudget* shared = nullptr;
+        optional<ExpansionBudget> own;
+};
+
+/**
+ * @brief Consumes a component value, and if the value is not monostate, pushes it to 'list'. A variable reference adds
+ * @brief a copy of the variable's values.
+ *
+ * @param list The NodeList or SmallVector to push the consumed value to
+ * @param arguments Whether 'list' is a function argument, where commas in a variable's value start new arguments
+ */
+
+template<typename List>
+void Parser::consumeComponentValue(List& list, bool arguments) {
+    if (auto variable = consumeReference(arguments)) {
+        spend(variable->nodes, std::get_if<Token>(&values[pos - 1]));
+
+        for (const ComponentValue& value : variable->values) {
+            list.emplace_back(clone(value));
+        }
+
+        return;
+    }
+
+    auto v = consumeComponentValue();
+
+    if (v.index()) {
+        list.emplace_back(std::move(v));
+    }
+}
+
+/**
+ * @return T* The innermost definition of 'name', nullptr if there is none
+ */
+
+template<typename T>
+T* Bindings<T>::find(Atom name) {
+    auto it = innermost.find(name);
+    return it == innermost.end() ? nullptr : &entries[it->second].value;
+}
+
+/**
+ * @brief Defines 'name' at 'depth'. Replaces a definition from the same block, otherwise hides the outer one until the
+ * @brief block is dropped.
+ */
+
+template<typename T>
+void Bindings<T>::define(Atom name, uint32_t depth, T value) {
+    auto [it, inserted] = innermost.try_emplace(name, (uint32_t) entries.size());
+    uint32_t shadowed = NONE;
+
+    if (!inserted) {
+        if (entries[it->second].depth == depth) {
+            entries[it->second].value = std::move(value);
+            return;
+        }
+
+        shadowed = it->second;
+        it->second = (uint32_t) entries.size();
+    }
+
+    entries.push_back({ name, depth, shadowed, std::move(value) });
+}
+
+/**
+ * @brief Drops the definitions made at 'depth' or deeper, bringing back the ones they hid
+ */
+
+template<typename T>
+void Bindings<T>::drop(uint32_t depth) {
+    while (!entries.empty() && entries.back().depth >= depth) {
+        Binding& binding = entries.back();
+
+        if (binding.shadowed == NONE) {
+            innermost.erase(binding.name);
+        }
+        else {
+            innermost[binding.name] = binding.shadowed;
+        }
+
+        entries.pop_back();
+    }
+}
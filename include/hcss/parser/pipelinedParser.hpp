@@ -0,0 +1,31 @@
+#pragma once
+
+#include "parser.hpp"
+#include "blockBuilder.hpp"
+#include <hcss/lexer/lexer.hpp>
+#include <hcss/util/spscQueue.hpp>
+#include <string_view>
+#include <vector>
+
+/**
+ * Lexes and parses at the same time. The lexer runs on its own thread and feeds a BlockBuilder, and the top-level values
+ * are handed to the parser in batches through a bounded SpscQueue. The parser works on the calling thread and blocks when
+ * it catches up with the lexer, and the lexer blocks when the parser falls 'capacity' batches behind.
+ *
+ * parse() returns the same rules as Parser(BlockBuilder values).parse(). 'lexer' owns escaped lexemes, so the rules must
+ * not outlive the PipelinedParser. lexer.lines is complete once parse() has returned.
+ */
+
+class PipelinedParser : public ValueSource {
+    public:
+        Lexer lexer;
+        // Caps the parse, see ExpansionLimits
+        ExpansionLimits limits;
+        explicit PipelinedParser(std::string_view source, size_t capacity = 16)
+            : lexer(source), queue(capacity)
+        {};
+        NodeList<SyntaxNode> parse();
+        bool pull(NodeList<ComponentValue>& values) override;
+    private:
+        SpscQueue<NodeList<ComponentValue>> queue;
+};
@@ -21,5 +21,5 @@ class SelectorParser : public ComponentValueParser {
         AttributeSelector consumeAttributeSelector();
         RelativeSelector consumeRelativeSelector();
         SimpleSelector consumeSimpleSelector();
-        vector<ComponentValue> consumeDeclarationValue(bool any = false);
+        NodeList<ComponentValue> consumeDeclarationValue(bool any = false);
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "parser.hpp"
+#include <hcss/lexer/lexer.hpp>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <string>
+#include <unordered_set>
+
+/**
+ * Parses a style sheet of any size in bounded memory. The input is read in blocks, cut after the last complete top-level
+ * rule found by a StructuralIndex, and each piece is lexed and parsed on its own. Rules are handed to a callback one at a
+ * time and dropped afterwards, so memory stays proportional to the block size plus the largest single rule. Build with
+ * HCSS_LARGE_FILES for inputs of 4 GiB or more.
+ *
+ * Because later input has not been read yet, a rule only sees the variables, mixins and at-rule aliases defined before
+ * it. Definitions outlive the piece they came from: their lexemes are copied into the parser when they are defined, as
+ * are the arguments of the mixin instances it caches. Names are not interned as they are lexed, only once they are looked
+ * up, so input with many distinct class names does not grow the atom table.
+ */
+
+class StreamingParser : public Parser, public ValueSource, public ValueStore {
+    public:
+        explicit StreamingParser(std::istream& input, size_t blockSize = 1 << 20)
+            : Parser(NodeList<ComponentValue> {}), input(input), blockSize(blockSize)
+        {
+            source = this;
+            store = this;
+        };
+        void parse(const std::function<void(SyntaxNode&)>& visit);
+        bool pull(NodeList<ComponentValue>& values) override;
+        void keep(Token& token) override;
+        void keep(NodeList<ComponentValue>& values) override;
+    private:
+        // A lexed piece of the input. Its tokens point into 'text' and into the lexer's storage.
+        struct Segment {
+            string text;
+            Lexer lexer;
+            explicit Segment(string&& text)
+                : text(std::move(text)), lexer(this->text)
+            {};
+        };
+        std::istream& input;
+        size_t blockSize;
+        // Input that has been read but not lexed yet
+        string window;
+        // Offset and line number of the first byte of 'window'
+        SourceOffset offset = 0;
+        int64_t line = 1;
+        bool exhausted = false;
+        bool finished = false;
+        // Every segment that values may still point into
+        deque<Segment> segments;
+        // The lexemes of the values kept past their segment. Elements of a set stay in place.
+        std::unordered_set<string> lexemes;
+        void keep(SimpleBlock& block);
+        void keep(ComponentValue& value);
+        size_t ruleBoundary() const;
+        void release();
+};
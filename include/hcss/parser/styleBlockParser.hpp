@@ -11,4 +11,8 @@ class StyleBlockParser : public Parser {
         optional<AtRule> consumeAtRule();
     private:
         StyleBlock block;
+        void include(Mixin& mixin, FunctionCall& call, int64_t start);
+        bool compile(Mixin& mixin, const Token& name, int64_t start);
+        static void trimImportant(Declaration& dec);
+        bool instantiate(const Mixin& mixin, SmallVector<std::pair<Atom, Variable>, 4>& arguments);
 };
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "parser.hpp"
+#include <hcss/lexer/lexer.hpp>
+#include <hcss/util/arena.hpp>
+#include <deque>
+#include <optional>
+#include <string_view>
+
+/**
+ * A parsed style sheet that owns all of its memory. The source text, the syntax tree and every child list in it are
+ * allocated from one Arena, so dropping the sheet frees a handful of blocks instead of walking the tree. reset() keeps
+ * the memory for the next parse, for workers that parse many sheets in a row.
+ *
+ * Lexemes that had escapes decoded live in the sheet's Lexer. Rules are only valid until the next parse() or reset().
+ *
+ * With a ThreadPool, the top-level rules of a large sheet are resolved on it. Each job allocates from an arena of its
+ * own that the sheet keeps next to its main one, see Parser::arenas.
+ */
+
+class Stylesheet {
+    public:
+        explicit Stylesheet(size_t blockSize = Arena::DEFAULT_BLOCK_SIZE, const ExpansionLimits& limits = {}, ThreadPool* pool = nullptr)
+            : arena(blockSize), limits(limits), pool(pool)
+        {};
+        Stylesheet(const Stylesheet&) = delete;
+        Stylesheet& operator=(const Stylesheet&) = delete;
+
+        NodeList<SyntaxNode>& parse(std::string_view source);
+        void reset();
+        NodeList<SyntaxNode>* rules() { return list; }
+        const LineIndex& lines() const { return lexer->lines; }
+        // How often the last parse reused a mixin instance, see Parser::includeStats()
+        const IncludeStats& includeStats() const { return includes; }
+        // Bytes the arenas have reserved, used or not
+        size_t capacity() const;
+    private:
+        Arena arena;
+        // The arenas of the jobs on 'pool'
+        std::deque<Arena> workers;
+        std::optional<Lexer> lexer;
+        // Lives in the arena and is never destroyed
+        NodeList<SyntaxNode>* list = nullptr;
+        IncludeStats includes;
+        // Caps each parse, see ExpansionLimits
+        ExpansionLimits limits;
+        ThreadPool* pool;
+};
@@ -3,12 +3,22 @@
 #include <variant>
 #include <hcss/lexer/token.hpp>
 #include <hcss/util/util.hpp>
+#include <hcss/util/arena.hpp>
+#include <hcss/util/smallVector.hpp>
+#include <vector>
 
 class AtRule;
+class Declaration;
 class FunctionCall;
 class QualifiedRule;
 class SimpleBlock;
 class StyleRule;
 
+// Child lists of the syntax tree. They come from the current Arena while a Stylesheet is parsing, otherwise the heap.
+template<typename T>
+using NodeList = std::vector<T, ArenaAllocator<T>>;
+
 using SyntaxNode = std::variant<std::monostate, AtRule, FunctionCall, QualifiedRule, SimpleBlock, StyleRule>;
-using ComponentValue = variant_append<SyntaxNode, Token>;
\ No newline at end of file
+using ComponentValue = variant_append<SyntaxNode, Token>;
+using StyleBlockVariant = std::variant<std::monostate, Declaration, AtRule, QualifiedRule, StyleRule>;
+using StyleBlock = NodeList<StyleBlockVariant>;
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A region allocator. Memory is handed out from large blocks and only returned to the system all at once, by
+ * @brief reset() or the destructor, so freeing costs one call per block however many objects were allocated.
+ *
+ * Allocations are bumped at their size rounded up to the alignment. deallocate() keeps the memory for reuse, so the
+ * temporaries of a parse (grown vectors, copied value lists) do not pile up. Small allocations go on a free list for
+ * their exact size: a vector grows through the same capacities every time, so those sizes recur. Large ones, like the
+ * value list of a block, rarely have the same size twice, so they are reused by the smallest freed one that fits. Once a
+ * parse has moved on from large lists to small nodes, a small allocation that has nothing to reuse is carved out of a
+ * freed large one before the arena grows.
+ *
+ * Objects in the arena are not destroyed. Only put things there whose memory all comes from the same arena.
+ */
+
+class Arena {
+    public:
+        static constexpr std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+        explicit Arena(std::size_t blockSize = DEFAULT_BLOCK_SIZE)
+            : blockSize(blockSize)
+        {};
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        ~Arena();
+
+        void* allocate(std::size_t size, std::size_t align);
+        void deallocate(void* p, std::size_t size, std::size_t align);
+        std::string_view copy(std::string_view text);
+        template<typename T, typename... Args>
+        T* create(Args&&... args);
+        void reset();
+        // Bytes reserved from the system, used or not
+        std::size_t capacity() const;
+        // The arena that ArenaAllocators constructed on this thread draw from, nullptr for the heap
+        static Arena* current() { return active; }
+    private:
+        friend class ArenaScope;
+        struct Block {
+            char* data;
+            std::size_t size;
+        };
+        // Alignment of every pooled allocation
+        static constexpr std::size_t GRAIN = alignof(std::max_align_t);
+        // Allocations up to this size go on 'freeLists', larger ones on 'largeFree'
+        static constexpr std::size_t SMALL_SIZE = 4096;
+        std::size_t blockSize;
+        std::vector<Block> blocks;
+        // Free space in the last block
+        char* pos = nullptr;
+        char* end = nullptr;
+        // Freed allocations of i * GRAIN bytes, linked through their first word
+        std::array<void*, SMALL_SIZE / GRAIN + 1> freeLists = {};
+        // Freed large slots, by size with four lists per power of two. A large slot starts with a GRAIN-sized header
+        // holding its size and the next slot on its list, so it goes back whole even when it served a smaller request.
+        std::array<char*, 256> largeFree = {};
+        std::size_t largeFreeCount = 0;
+        // What is left of the freed large slot small allocations are carved from
+        char* carvePos = nullptr;
+        char* carveEnd = nullptr;
+        void* allocateLarge(std::size_t size);
+        char* takeLarge(std::size_t size);
+        void* allocateSmall(std::size_t size);
+        static thread_local Arena* active;
+        char* bump(std::size_t size, std::size_t align);
+        void grow(std::size_t size);
+};
+
+/**
+ * @brief Makes 'arena' the current arena of this thread for its lifetime. Scopes nest.
+ */
+
+class ArenaScope {
+    public:
+        explicit ArenaScope(Arena& arena)
+            : previous(Arena::active)
+        {
+            Arena::active = &arena;
+        };
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+        ~ArenaScope() {
+            Arena::active = previous;
+        }
+    private:
+        Arena* previous;
+};
+
+/**
+ * @brief Allocates from the arena that was current when it was constructed, or from the heap if there was none.
+ *
+ * Moves keep the source's arena, copies use the current one. A copy made outside any scope is therefore an ordinary heap
+ * object even if the original lives in an arena.
+ */
+
+template<typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    Arena* arena = Arena::current();
+    ArenaAllocator() = default;
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : arena(other.arena)
+    {};
+    T* allocate(std::size_t n) {
+        return arena ? (T*) arena->allocate(n * sizeof(T), alignof(T)) : std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, std::size_t n) {
+        if (arena) {
+            arena->deallocate(p, n * sizeof(T), alignof(T));
+        }
+        else {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+    ArenaAllocator select_on_container_copy_construction() const {
+        return {};
+    }
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+};
+
+/**
+ * @brief Constructs a T in the arena. Its destructor is never run.
+ */
+
+template<typename T, typename... Args>
+T* Arena::create(Args&&... args) {
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/**
+ * @brief A read-only memory mapping of a whole file. The mapping is released when the object is destroyed, so any
+ * @brief Lexer (and tokens) built over view() must not outlive it.
+ */
+
+class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path);
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        const char* data() const { return ptr; }
+        std::size_t size() const { return length; }
+        std::string_view view() const { return { ptr, length }; }
+    private:
+        const char* ptr = nullptr;
+        std::size_t length = 0;
+};
@@ -0,0 +1,189 @@
+#pragma once
+#include "arena.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief A vector that keeps its first N elements inside the object and only allocates once it grows past them.
+ *
+ * Meant for the short child lists of the syntax tree, which mostly hold one or two items. Past N the elements move to
+ * memory from the allocator, an ArenaAllocator by default, so a long list behaves like a NodeList. Like the tree's
+ * nodes it is move-only. Moving a list that is still inline moves its elements one by one, so pointers into it do not
+ * survive a move the way they do for std::vector.
+ *
+ * T must be complete where the SmallVector is declared, so a node cannot hold a SmallVector of a variant it is itself
+ * an alternative of.
+ */
+
+template<typename T, std::size_t N, typename Allocator = ArenaAllocator<T>>
+class SmallVector {
+    static_assert(N > 0, "Use a NodeList for lists without inline storage");
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<T*>;
+        using const_reverse_iterator = std::reverse_iterator<const T*>;
+
+        SmallVector() = default;
+        SmallVector(const SmallVector&) = delete;
+        SmallVector& operator=(const SmallVector&) = delete;
+        SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            take(other);
+        }
+        SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if (this != &other) {
+                release();
+                take(other);
+            }
+
+            return *this;
+        }
+        ~SmallVector() {
+            release();
+        }
+
+        T* begin() { return items; }
+        T* end() { return items + count; }
+        const T* begin() const { return items; }
+        const T* end() const { return items + count; }
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+        T* data() { return items; }
+        const T* data() const { return items; }
+        T& operator[](std::size_t i) { return items[i]; }
+        const T& operator[](std::size_t i) const { return items[i]; }
+        T& front() { return items[0]; }
+        const T& front() const { return items[0]; }
+        T& back() { return items[count - 1]; }
+        const T& back() const { return items[count - 1]; }
+        std::size_t size() const { return count; }
+        std::size_t capacity() const { return room; }
+        bool empty() const { return count == 0; }
+        // Whether the elements are still in the object's own storage
+        bool isInline() const { return items == local(); }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args);
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+        void push_back(const T& value) { emplace_back(value); }
+        void pop_back() {
+            std::destroy_at(items + --count);
+        }
+        T* erase(const T* pos);
+        void reserve(std::size_t n);
+        void clear() {
+            std::destroy(begin(), end());
+            count = 0;
+        }
+    private:
+        T* items = local();
+        uint32_t count = 0;
+        uint32_t room = N;
+        Allocator allocator;
+        alignas(T) unsigned char storage[N * sizeof(T)];
+        T* local() { return std::launder(reinterpret_cast<T*>(storage)); }
+        const T* local() const { return std::launder(reinterpret_cast<const T*>(storage)); }
+        void take(SmallVector& other);
+        void release();
+        void relocate(T* to, std::size_t capacity);
+};
+
+/**
+ * @brief Constructs an element at the end. When the list is full the new element is built in the larger buffer before
+ * @brief the old ones move, so 'args' may refer to an element of the list.
+ */
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename... Args>
+T& SmallVector<T, N, Allocator>::emplace_back(Args&&... args) {
+    if (count < room) {
+        T* item = new (items + count) T(std::forward<Args>(args)...);
+        count++;
+        return *item;
+    }
+
+    std::size_t capacity = (std::size_t) room * 2;
+    T* to = allocator.allocate(capacity);
+    T* item = new (to + count) T(std::forward<Args>(args)...);
+    relocate(to, capacity);
+    count++;
+    return *item;
+}
+
+template<typename T, std::size_t N, typename Allocator>
+T* SmallVector<T, N, Allocator>::erase(const T* pos) {
+    T* at = items + (pos - items);
+    std::move(at + 1, end(), at);
+    pop_back();
+    return at;
+}
+
+template<typename T, std::size_t N, typename Allocator>
+void SmallVector<T, N, Allocator>::reserve(std::size_t n) {
+    if (n > room) {
+        relocate(allocator.allocate(n), n);
+    }
+}
+
+/**
+ * @brief Moves the elements to 'to', which has room for 'capacity' of them, and frees the old buffer if it was allocated
+ */
+
+template<typename T, std::size_t N, typename Allocator>
+void SmallVector<T, N, Allocator>::relocate(T* to, std::size_t capacity) {
+    std::uninitialized_move(begin(), end(), to);
+    std::destroy(begin(), end());
+
+    if (!isInline()) {
+        allocator.deallocate(items, room);
+    }
+
+    items = to;
+    room = (uint32_t) capacity;
+}
+
+/**
+ * @brief Takes the elements of 'other', which is left empty. An allocated buffer changes hands along with the allocator
+ * @brief it came from.
+ */
+
+template<typename T, std::size_t N, typename Allocator>
+void SmallVector<T, N, Allocator>::take(SmallVector& other) {
+    if (other.isInline()) {
+        std::uninitialized_move(other.begin(), other.end(), local());
+        items = local();
+        count = other.count;
+        room = N;
+        other.clear();
+    }
+    else {
+        items = other.items;
+        count = other.count;
+        room = other.room;
+        allocator = other.allocator;
+        other.items = other.local();
+        other.count = 0;
+        other.room = N;
+    }
+}
+
+template<typename T, std::size_t N, typename Allocator>
+void SmallVector<T, N, Allocator>::release() {
+    clear();
+
+    if (!isInline()) {
+        allocator.deallocate(items, room);
+        items = local();
+        room = N;
+    }
+}
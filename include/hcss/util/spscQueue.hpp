@@ -0,0 +1,129 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A bounded ring buffer for exactly one producer thread and one consumer thread. The indices are plain atomics, so
+ * @brief neither side ever takes a lock. push() blocks while the ring is full and pop() while it is empty.
+ *
+ * Either side can end the stream: the producer calls close() after its last push, and the consumer calls cancel() if it
+ * stops early, which makes every later push() fail instead of blocking forever.
+ */
+
+template<typename T>
+class SpscQueue {
+    public:
+        explicit SpscQueue(std::size_t capacity);
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        bool push(T&& value);
+        bool pop(T& value);
+        void close();
+        void cancel();
+    private:
+        // Set on 'tail' by close() and on 'head' by cancel(). Changing the index itself wakes a side blocked on it.
+        static constexpr std::size_t CLOSED = (std::size_t) 1 << (sizeof(std::size_t) * 8 - 1);
+        std::vector<T> slots;
+        std::size_t mask;
+        // Next slot to read, only written by the consumer
+        alignas(64) std::atomic<std::size_t> head = 0;
+        // Next slot to write, only written by the producer
+        alignas(64) std::atomic<std::size_t> tail = 0;
+};
+
+/**
+ * @param capacity The number of slots, rounded up to a power of two
+ */
+
+template<typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity) {
+    std::size_t size = 1;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    slots.resize(size);
+    mask = size - 1;
+}
+
+/**
+ * @brief Producer side. Waits for a free slot and moves 'value' into it.
+ *
+ * @return false If the consumer cancelled, in which case 'value' is left untouched
+ */
+
+template<typename T>
+bool SpscQueue<T>::push(T&& value) {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+
+    while (true) {
+        std::size_t h = head.load(std::memory_order_acquire);
+
+        if (h & CLOSED) {
+            return false;
+        }
+        else if (t - h < slots.size()) {
+            break;
+        }
+
+        head.wait(h, std::memory_order_acquire);
+    }
+
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    tail.notify_one();
+    return true;
+}
+
+/**
+ * @brief Consumer side. Waits for a value and moves it out into 'value'.
+ *
+ * @return false Once the producer has closed the queue and every value has been popped
+ */
+
+template<typename T>
+bool SpscQueue<T>::pop(T& value) {
+    std::size_t h = head.load(std::memory_order_relaxed);
+
+    while (true) {
+        std::size_t t = tail.load(std::memory_order_acquire);
+
+        if ((t & ~CLOSED) != h) {
+            break;
+        }
+        else if (t & CLOSED) {
+            return false;
+        }
+
+        tail.wait(t, std::memory_order_acquire);
+    }
+
+    value = std::move(slots[h & mask]);
+    head.store(h + 1, std::memory_order_release);
+    head.notify_one();
+    return true;
+}
+
+/**
+ * @brief Producer side. Marks the end of the stream. Values already pushed can still be popped.
+ */
+
+template<typename T>
+void SpscQueue<T>::close() {
+    tail.fetch_or(CLOSED, std::memory_order_release);
+    tail.notify_one();
+}
+
+/**
+ * @brief Consumer side. Stops the producer: pushes fail from now on. Nothing is popped after this.
+ */
+
+template<typename T>
+void SpscQueue<T>::cancel() {
+    head.fetch_or(CLOSED, std::memory_order_release);
+    head.notify_one();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that run submitted jobs in FIFO order. The destructor finishes the queued jobs
+ * @brief before joining the workers.
+ */
+
+class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+        template<typename F>
+        std::future<std::invoke_result_t<F>> submit(F&& job);
+        unsigned size() const { return (unsigned) workers.size(); }
+        // Process-wide pool sized to the hardware, created on first use
+        static ThreadPool& shared();
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> queue;
+        std::mutex lock;
+        std::condition_variable ready;
+        bool stopping = false;
+        void work();
+};
+
+/**
+ * @brief Queues 'job' to run on a worker
+ *
+ * @return std::future The job's result. Exceptions thrown by the job are rethrown by get().
+ */
+
+template<typename F>
+std::future<std::invoke_result_t<F>> ThreadPool::submit(F&& job) {
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(job));
+    auto result = task->get_future();
+
+    {
+        std::lock_guard guard(lock);
+        queue.emplace_back([task] { (*task)(); });
+    }
+
+    ready.notify_one();
+    return result;
+}
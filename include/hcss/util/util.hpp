@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <variant>
 
 template <typename T, typename... Args> struct concatenator;
@@ -12,4 +13,5 @@ struct concatenator<std::variant<Args0...>, Args1...> {
 template <typename V, typename... Args1>
 using variant_append = typename concatenator<V, Args1...>::type;
 
-bool wstrcompi(std::wstring str1, std::wstring str2);
\ No newline at end of file
+bool strcompi(std::string_view str1, std::string_view str2);
+void appendUtf8(std::string& str, char32_t codePoint);
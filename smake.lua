@@ -15,4 +15,23 @@ function smake.build()
 
     runIn('build', 'ar rvs libhcss.a *.o')
     run('rm ./*.o')
-end
\ No newline at end of file
+end
+
+function smake.test()
+    smake.build()
+
+    run('g++ -std=c++20 -O2 -Iinclude tests/allocations.cpp tests/allocationCounter.cpp build/libhcss.a -lpthread -o build/allocations')
+    run('./build/allocations tests/reference.css')
+    run('g++ -std=c++20 -O2 -Iinclude tests/parser.cpp build/libhcss.a -lpthread -o build/parser')
+    run('./build/parser')
+    run('g++ -std=c++20 -O2 -Iinclude tests/streaming.cpp build/libhcss.a -lpthread -o build/streaming')
+    run('./build/streaming')
+end
+
+function smake.bench()
+    smake.build()
+
+    run('g++ -std=c++20 -O2 -Iinclude bench/parse.cpp tests/allocationCounter.cpp build/libhcss.a -lpthread -o build/parse')
+    run('./build/parse heap')
+    run('./build/parse arena')
+end
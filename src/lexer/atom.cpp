@@ -0,0 +1,94 @@
+#include <hcss/lexer/atom.hpp>
+#include <string>
+#include <deque>
+#include <array>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+	struct AtomTable {
+		// deque keeps the names in place, so the views handed out by atomName stay valid
+		std::deque<std::string> names { std::string() };
+		std::unordered_map<std::string_view, Atom> ids { { names.front(), ATOM_NONE } };
+		std::shared_mutex mutex;
+	};
+
+	AtomTable& table() {
+		static AtomTable atoms;
+		return atoms;
+	}
+
+	// Per-thread direct-mapped cache in front of the table, so repeated names never take the lock
+	struct CacheEntry {
+		const char* name = nullptr;
+		std::size_t size = 0;
+		Atom atom = ATOM_NONE;
+	};
+
+	constexpr std::size_t CACHE_SIZE = 4096;
+	thread_local std::array<CacheEntry, CACHE_SIZE> cache;
+}
+
+/**
+ * @brief Returns the atom for a name. Names are case-sensitive, and equal names always get the same atom, across
+ * @brief lexers and threads.
+ *
+ * @param name The name to intern
+ * @return Atom The name's atom, interning it if it has not been seen before
+ */
+
+Atom internAtom(std::string_view name) {
+	std::size_t hash = std::hash<std::string_view>()(name);
+	CacheEntry& entry = cache[hash & (CACHE_SIZE - 1)];
+
+	if (entry.name && entry.size == name.size() && std::memcmp(entry.name, name.data(), name.size()) == 0) {
+		return entry.atom;
+	}
+
+	AtomTable& atoms = table();
+	std::string_view stored;
+	Atom atom;
+
+	{
+		std::shared_lock lock(atoms.mutex);
+
+		if (auto it = atoms.ids.find(name); it != atoms.ids.end()) {
+			stored = it->first;
+			atom = it->second;
+		}
+	}
+
+	if (!stored.data()) {
+		std::unique_lock lock(atoms.mutex);
+
+		if (auto it = atoms.ids.find(name); it != atoms.ids.end()) {
+			stored = it->first;
+			atom = it->second;
+		}
+		else {
+			if (atoms.names.size() > UINT32_MAX) {
+				throw std::length_error("Too many distinct names");
+			}
+
+			atom = (Atom) atoms.names.size();
+			stored = atoms.names.emplace_back(name);
+			atoms.ids.emplace(stored, atom);
+		}
+	}
+
+	entry = { stored.data(), stored.size(), atom };
+	return atom;
+}
+
+/**
+ * @brief Returns the name of an atom. The view stays valid for the life of the program.
+ */
+
+std::string_view atomName(Atom atom) {
+	AtomTable& atoms = table();
+	std::shared_lock lock(atoms.mutex);
+	return atom < atoms.names.size() ? std::string_view(atoms.names[atom]) : std::string_view();
+}
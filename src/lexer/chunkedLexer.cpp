@@ -0,0 +1,187 @@
+#include <hcss/lexer/chunkedLexer.hpp>
+#include <stdexcept>
+
+// The lexer looks at most three bytes past the end of a token ("<!--", an escape after "-"), so a token that ends at
+// least this far from the end of the buffered input can no longer change when more input arrives.
+constexpr int LOOKAHEAD = 3;
+
+/**
+ * @brief Lexes the tokens that 'chunk' completes. Anything that could still continue is kept for the next call.
+ *
+ * @param chunk The next piece of input, which does not need to outlive the call
+ */
+
+void ChunkedLexer::feed(string_view chunk) {
+	if ((uint64_t) chunk.size() >= NO_SOURCE_OFFSET - offset - pending.size()) {
+		throw std::length_error("Source is too large for 32-bit offsets. Build with HCSS_LARGE_FILES.");
+	}
+
+	if (inComment && (chunk = skipComment(chunk)).empty()) {
+		return;
+	}
+
+	pending.append(chunk);
+
+	if (open != OPEN_NONE && stillOpen()) {
+		return;
+	}
+
+	open = OPEN_NONE;
+	run(false);
+}
+
+/**
+ * @brief Lexes whatever is left once the input has ended and emits T_EOF
+ */
+
+void ChunkedLexer::finish() {
+	if (!inComment) {
+		run(true);
+	}
+
+	Token eof(T_EOF, {}, offset);
+	sink(eof);
+	pending.clear();
+	inComment = trailingStar = false;
+	open = OPEN_NONE;
+}
+
+void ChunkedLexer::run(bool final) {
+	Lexer lexer(pending);
+	lexer.offsetBase = offset;
+
+	while (lexer.pos < lexer.end) {
+		const char* pos = lexer.pos;
+		size_t lineCount = lexer.lines.starts.size();
+
+		lexer.lexToken();
+
+		if (!final && lexer.end - lexer.pos < LOOKAHEAD) {
+			lexer.tokens.clear();
+			lexer.pos = pos;
+			lexer.lines.starts.resize(lineCount);
+			break;
+		}
+
+		for (const Token& t : lexer.tokens) {
+			sink(t);
+		}
+
+		lexer.tokens.clear();
+	}
+
+	lines.starts.insert(lines.starts.end(), lexer.lines.starts.begin() + 1, lexer.lines.starts.end());
+	offset += (SourceOffset) (lexer.pos - lexer.begin);
+	pending.erase(0, lexer.pos - lexer.begin);
+
+	// An unterminated comment would otherwise be rescanned from its start on every feed
+	if (!final && pending.starts_with("/*") && pending.find("*/", 2) == string::npos) {
+		inComment = true;
+		trailingStar = pending.size() > 2 && pending.back() == '*';
+		advance(pending);
+		pending.clear();
+	}
+	else if (!final) {
+		findOpen();
+	}
+}
+
+/**
+ * @brief Checks whether 'pending' starts with a string or unquoted url that runs to the end of the input so far, so the
+ * @brief next feed() only has to scan the new bytes for its end
+ */
+
+void ChunkedLexer::findOpen() {
+	if (pending.starts_with('"') || pending.starts_with('\'')) {
+		open = OPEN_STRING;
+		quote = pending.front();
+		scanned = 1;
+	}
+	else if (pending.size() > 4 && keywordId(string_view(pending).substr(0, 3)) == KW_URL && pending[3] == '(') {
+		size_t start = pending.find_first_not_of(" \t\n", 4);
+
+		// Before the first byte of the url it is not known yet whether it is quoted
+		if (start == string::npos || pending[start] == '"' || pending[start] == '\'') {
+			return;
+		}
+
+		open = OPEN_URL;
+		scanned = start;
+	}
+	else {
+		return;
+	}
+
+	if (!stillOpen()) {
+		open = OPEN_NONE;
+	}
+}
+
+/**
+ * @brief Scans the bytes of the open string or url that arrived since the last call. Escapes are stepped over, and
+ * @brief anything else that stops the scan kernel may end the token, which is left to the lexer.
+ *
+ * @return true If the token still runs to the end of 'pending'
+ */
+
+bool ChunkedLexer::stillOpen() {
+	const char* begin = pending.data();
+	const char* end = begin + pending.size();
+	const char* p = begin + scanned;
+
+	while (true) {
+		const char* stop = open == OPEN_STRING ? scanKernels().findStringStop(p, end, quote) : scanKernels().findUrlStop(p, end);
+
+		if (stop == end || (*stop == '\\' && end - stop < 2)) {
+			scanned = stop - begin;
+			return true;
+		}
+		else if (*stop != '\\') {
+			return false;
+		}
+
+		p = stop + 2;
+	}
+}
+
+/**
+ * @brief Consumes the part of 'chunk' that belongs to an open comment
+ *
+ * @return string_view The rest of the chunk after the comment, empty if the comment is still open
+ */
+
+string_view ChunkedLexer::skipComment(string_view chunk) {
+	if (chunk.empty()) {
+		return chunk;
+	}
+
+	size_t after;
+
+	if (trailingStar && chunk.front() == '/') {
+		after = 1;
+	}
+	else {
+		const char* close = scanKernels().findCommentEnd(chunk.data(), chunk.data() + chunk.size());
+
+		if (close == chunk.data() + chunk.size()) {
+			trailingStar = chunk.back() == '*';
+			advance(chunk);
+			return {};
+		}
+
+		after = close - chunk.data() + 2;
+	}
+
+	inComment = trailingStar = false;
+	advance(chunk.substr(0, after));
+	return chunk.substr(after);
+}
+
+/**
+ * @brief Moves the carried offset past bytes that were skipped without lexing, recording their line breaks
+ */
+
+void ChunkedLexer::advance(string_view skipped) {
+	scanKernels().recordNewlines(skipped.data(), skipped.data() + skipped.size(), offset, lines.starts);
+	offset += (SourceOffset) skipped.size();
+}
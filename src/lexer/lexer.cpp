@@ -1,278 +1,413 @@
 #include <hcss/util/util.hpp>
 #include <hcss/lexer/lexer.hpp>
 #include <hcss/lexer/tokenType.hpp>
-#include <iostream>
+#include <hcss/lexer/charClass.hpp>
+#include <iterator>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
 using std::get;
 
 #pragma region Helpers
 
-inline bool isHex(wchar_t c) {
-	return isdigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+// The helpers below classify single bytes (or EOF) through the charClasses table. Every byte of a multi-byte UTF-8
+// sequence is >= 0x80, so the non-ASCII rule of the CSS syntax spec holds byte by byte and no decoding is needed to find
+// ident boundaries.
+
+inline bool isDigit(int c) {
+	return hasClass(c, CC_DIGIT);
 }
 
-inline bool nonAscii(wchar_t c) {
-	return c >= 128;
+inline bool isHex(int c) {
+	return hasClass(c, CC_HEX);
 }
 
-inline bool identStartCodePoint(wchar_t c) {
-	return isalpha(c) || nonAscii(c) || c == '_';
+inline int hexValue(int c) {
+	return isDigit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
 }
 
-inline bool identCodePoint(wchar_t c) {
-	return identStartCodePoint(c) || isdigit(c) || c == '-';
+inline bool identStartCodePoint(int c) {
+	return hasClass(c, CC_IDENT_START);
 }
 
-inline bool isSpace(wchar_t c) {
-	return c == '\t' || c == '\n' || c == ' ';
+inline bool identCodePoint(int c) {
+	return hasClass(c, CC_IDENT);
 }
 
 #pragma endregion
 
 #pragma region Lexer
 
+/**
+ * @brief Constructs a lexer over the full contents of a stream. The stream is read into an owned buffer up front, and the
+ * @brief buffer is then scanned exactly like a caller-owned one.
+ *
+ * @param stream The stream to read the style sheet from
+ */
+
+Lexer::Lexer(std::istream& stream)
+	: buffer(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>())
+{
+	begin = pos = buffer.data();
+	end = begin + buffer.size();
+}
+
 vector<Token>& Lexer::lex() {
-	while (reader.peek() != EOF) {
-        current = reader.get();
-		switch (current) {
-			case '(':
+	if ((uint64_t) (end - begin) >= NO_SOURCE_OFFSET - offsetBase) {
+		throw std::length_error("Source is too large for 32-bit offsets. Build with HCSS_LARGE_FILES.");
+	}
+
+	while (pos < end) {
+		lexToken();
+	}
+
+	mark = pos;
+    emit(Token(T_EOF, {}, offsetOf(pos)));
+    return tokens;
+}
+
+/**
+ * @brief Lexes one token starting at the read position. Whitespace and comments are consumed without emitting anything.
+ */
+
+void Lexer::lexToken() {
+	mark = pos;
+	int current = (unsigned char) *pos++;
+
+	switch (current) {
+		case '(':
                 addToken(LEFT_PAREN); break;
-			case ')':
+		case ')':
                 addToken(RIGHT_PAREN); break;
-			case '[':
+		case '[':
                 addToken(LEFT_BRACKET); break;
-			case ']':
+		case ']':
                 addToken(RIGHT_BRACKET); break;
-			case '{':
+		case '{':
                 addToken(LEFT_BRACE); break;
-			case '}':
+		case '}':
                 addToken(RIGHT_BRACE); break;
-			case ',':
+		case ',':
                 addToken(COMMA); break;
-			case ':':
+		case ':':
                 addToken(COLON); break;
-			case ';':
+		case ';':
                 addToken(SEMICOLON); break;
-			case '\n': line++;
-            case '\t': case ' ':
+		case '\n': case '\t': case ' ':
+			pos--;
                 consumeWhitespace(); break;
-			case '\'': case '"':
+		case '\'': case '"':
                 consumeString(); break;
-			case '#': {
-				if (identCodePoint(reader.peek())) {
+		case '#': {
+			if (identCodePoint(peek()) || (peek() == '\\' && peek(1) != '\n')) {
                     consumeHash();
-				}
-				else if (reader.peek() == '\\') {
-                    wchar_t next = reader.ignore().peek();
-					reader.unget();
-
-					if (next != '\n') {
-                        consumeHash();
-					}
-				}
-				else {
+			}
+			else {
                     addToken(DELIM);
-				}
-				break;
 			}
-			case '+': case '.': {
-				if (isdigit(reader.peek())) {
-					reader.unget();
+			break;
+		}
+		case '+': case '.': {
+			if (isDigit(peek())) {
+				pos--;
                     consumeNumericToken();
-				}
-				else {
+			}
+			else {
                     addToken(DELIM);
-				}
-				break;
 			}
-			case '-': {
-				if (isdigit(reader.peek())) {
-					reader.unget();
+			break;
+		}
+		case '-': {
+			if (isDigit(peek())) {
+				pos--;
                     consumeNumericToken();
-				}
-				else if (reader.peek() == '-') {
-					if (reader.ignore().peek() == '>') {
-                        addToken(CDC);
-					}
-					else {
-						reader.unget();
-					}
-
-					if (isIdentSequence()) {
-						reader.unget();
-                        consumeIdentLike();
-					}
-				}
-				else if (isIdentSequence()) {
-					reader.unget();
+			}
+			else if (peek() == '-' && peek(1) == '>') {
+				pos += 2;
+				addToken(CDC);
+			}
+			else if (isIdentSequence()) {
+				pos--;
                     consumeIdentLike();
-				}
-				else {
+			}
+			else {
                     addToken(DELIM);
-				}
-				break;
 			}
-			case '<': {
-				if (reader.peek() == '!') {
-					if (reader.ignore().get() == '-' && reader.peek() == '-') {
-                        addToken(CDO);
-					}
-					else {
-						reader.unget().unget();
-                        addToken(DELIM);
-					}
-				}
-				else {
+			break;
+		}
+		case '<': {
+			if (peek() == '!' && peek(1) == '-' && peek(2) == '-') {
+				pos += 3;
+				addToken(CDO);
+			}
+			else {
                     addToken(DELIM);
-				}
-				break;
 			}
-			case '@': {
-				if (isIdentSequence()) {
-					tokens.emplace_back(AT_KEYWORD, consumeIdent());
-				}
-				else {
+			break;
+		}
+		case '@': {
+			if (isIdentSequence()) {
+				addToken(AT_KEYWORD, consumeIdent());
+			}
+			else {
                     addToken(DELIM);
-				}
-				break;
 			}
-			case '\\': {
-				if (reader.peek() != '\n') {
-					reader.unget();
+			break;
+		}
+		case '\\': {
+			if (peek() != '\n') {
+				pos--;
                     consumeIdentLike();
-				}
-				else {
+			}
+			else {
                     addToken(DELIM);
-				}
-				break;
 			}
-			case '/': {
-				if (reader.peek() == '*') {
-					while (reader.peek() != EOF) {
-						if (reader.get() == '*' && reader.get() == '/') {
-							break;
-						}
-					}
-				}
-				else {
-					addToken(DELIM);
-				}
-
-				break;
+			break;
+		}
+		case '/': {
+			if (peek() == '*') {
+				pos++;
+				consumeComment();
+			}
+			else {
+				addToken(DELIM);
 			}
-			default: {
-				if (isdigit(current)) {
-					reader.unget();
+
+			break;
+		}
+		default: {
+			if (isDigit(current)) {
+				pos--;
                     consumeNumericToken();
-				}
-				else if (identStartCodePoint(current)) {
-					reader.unget();
+			}
+			else if (identStartCodePoint(current)) {
+				pos--;
                     consumeIdentLike();
-				}
-				else {
+			}
+			else {
                     addToken(DELIM);
-				}
-				break;
 			}
+			break;
 		}
 	}
+}
 
-    tokens.emplace_back(T_EOF);
-    return tokens;
+/**
+ * @brief Lexes into a structure-of-arrays stream instead of Token objects
+ *
+ * @param stream The stream to append to. 'tokens' is left untouched.
+ */
+
+TokenStream& Lexer::lex(TokenStream& stream) {
+	this->stream = &stream;
+	lex();
+	this->stream = nullptr;
+	return stream;
+}
+
+/**
+ * @brief Lexes straight into 'sink'. 'tokens' is left untouched.
+ */
+
+void Lexer::lex(TokenSink& sink) {
+	this->sink = &sink;
+	lex();
+	this->sink = nullptr;
+}
+
+/**
+ * @brief Peeks a byte ahead of the read position without consuming it
+ *
+ * @param offset The distance from the read position (default 0)
+ * @return int The byte at that position, or EOF past the end of the buffer
+ */
+
+inline int Lexer::peek(int offset) const {
+	return offset < end - pos ? (unsigned char) pos[offset] : EOF;
+}
+
+/**
+ * @brief Records a line break. 'at' is the position of the newline character itself.
+ */
+
+inline void Lexer::newline(const char* at) {
+	lines.starts.push_back(offsetOf(at + 1));
+}
+
+/**
+ * @brief Copies [from, to) into lexer-owned storage. Used for lexemes that escapes or dropped characters keep from being
+ * @brief a plain view of the source.
+ */
+
+string& Lexer::own(const char* from, const char* to) {
+	return storage.emplace_back(from, to);
+}
+
+/**
+ * @brief Hands a finished token to the output. The token's source extent is [mark, pos).
+ */
+
+void Lexer::emit(Token&& t) {
+	if (stream) {
+		stream->types.push_back(t.type);
+		stream->offsets.push_back(offsetOf(mark));
+		stream->lengths.push_back((SourceOffset) (pos - mark));
+	}
+	else if (sink) {
+		sink->push(std::move(t));
+	}
+	else {
+		tokens.push_back(std::move(t));
+	}
 }
 
 void Lexer::addToken(TokenType type) {
-	tokens.emplace_back(type, wstring(1, current), COLUMN, line);
+	emit(Token(type, string_view(mark, pos - mark), offsetOf(mark), internNames));
+}
+
+void Lexer::addToken(TokenType type, string_view lexeme) {
+	emit(Token(type, lexeme, offsetOf(mark), internNames));
+}
+
+/**
+ * @brief Accounts for the line breaks in [from, to), which the caller has skipped in bulk
+ */
+
+void Lexer::newlines(const char* from, const char* to) {
+	scan.recordNewlines(from, to, offsetOf(from), lines.starts);
 }
 
 void Lexer::consumeWhitespace() {
-	while (isSpace(reader.peek())) {
-        auto c = (wchar_t)reader.get();
+	const char* start = pos;
+	pos = scan.skipWhitespace(pos, end);
+	newlines(start, pos);
+}
 
-        if (c == '\n') {
-            posOffset = (int)reader.tellg();
-            line++;
-        }
-	}
+/**
+ * @brief Skips the body of a comment. The opening '/' '*' has already been consumed.
+ */
+
+void Lexer::consumeComment() {
+	const char* close = scan.findCommentEnd(pos, end);
+	newlines(pos, close);
+	pos = close == end ? end : close + 2;
 }
 
-wchar_t Lexer::consumeEscapedCodePoint() {
-    int c = reader.get();
+/**
+ * @brief Consumes an escape after its backslash. Invalid code points decode to U+FFFD.
+ */
 
-	if (c != '\n') {
-		if (isHex(c)) {
-			wstring hex = wstring(1, c);
+char32_t Lexer::consumeEscapedCodePoint() {
+	if (pos == end) {
+		return 0xFFFD;
+	}
 
-			while (hex.size() < 6 && isHex(reader.peek())) {
-				hex += static_cast<wchar_t>(reader.get());
-			}
+	int c = (unsigned char) *pos++;
 
-			int n = std::stoi(hex, nullptr, 16);
-			if (n == 0 || n > 1114111 || (n >= 55296 && n <= 57343)) {
-				return '\0';
-			}
+	if (isHex(c)) {
+		int n = hexValue(c);
 
-			return  n;
-		}
-		else if (c == EOF) {
-			return '\0';
+		for (int digits = 1; digits < 6 && isHex(peek()); digits++) {
+			n = n * 16 + hexValue(*pos++);
 		}
-		else {
-			return c;
+
+		if (n == 0 || n > 1114111 || (n >= 55296 && n <= 57343)) {
+			return 0xFFFD;
 		}
+
+		return n;
 	}
-	else {
-		reader.ignore();
+	else if (c == '\n') {
+		newline(pos - 1);
+		return 0xFFFD;
 	}
 
-	return '\0';
+	return c;
 }
 
 void Lexer::consumeString() {
-	Token t(STRING, {}, COLUMN, line);
-	wchar_t end = current;
-    t.flags["quote"] = end;
+	Token t(STRING, {}, offsetOf(mark));
+	char quote = *mark;
+	const char* start = pos;
+	string* owned = nullptr;
+	t.quote = quote;
+
+	while (pos < end) {
+		const char* stop = scan.findStringStop(pos, end, quote);
+
+		if (owned) {
+			owned->append(pos, stop);
+		}
 
-	while (true) {
-        int c = reader.get();
+		if ((pos = stop) == end) {
+			break;
+		}
+
+		char c = *pos++;
+
+		if (c == quote) {
+			t.lexeme = owned ? string_view(*owned) : string_view(start, pos - 1 - start);
+			emit(std::move(t));
+			return;
+		}
 
 		switch (c) {
-			case EOF: tokens.push_back(t); return;
             case '\n': {
-				reader.unget();
-				tokens.emplace_back(BAD_STRING, t.lexeme);
+				pos--;
+				addToken(BAD_STRING, owned ? string_view(*owned) : string_view(start, pos - start));
 				return;
 			}
 			case '\\': {
-				t.lexeme += consumeEscapedCodePoint();
-				break;
-			}
-			default: {
-				if (c != end) {
-					t.lexeme += (wchar_t)c;
+				if (!owned) {
+					owned = &own(start, pos - 1);
+				}
+
+				if (pos == end) {
+					break;
+				}
+				else if (*pos == '\n') {
+					newline(pos++);
 				}
 				else {
-					tokens.push_back(t);
-					return;
+					appendUtf8(*owned, consumeEscapedCodePoint());
 				}
+				break;
 			}
+			default: break;
 		}
 	}
+
+	t.lexeme = owned ? string_view(*owned) : string_view(start, pos - start);
+	emit(std::move(t));
 }
 
-wstring Lexer::consumeIdent() {
-	wstring result;
+/**
+ * @brief Consumes an ident sequence. The result is a view of the source unless it contains escapes.
+ */
 
-	while (true) {
-        wchar_t c = reader.get();
+string_view Lexer::consumeIdent() {
+	const char* start = pos;
 
-		if (identCodePoint(c)) {
-			result += c;
-		}
-		else if (c == '\\' && reader.peek() != '\n') {
-			result += consumeEscapedCodePoint();
+	pos = scan.skipIdent(pos, end);
+
+	if (peek() != '\\' || peek(1) == '\n') {
+		return { start, (size_t) (pos - start) };
+	}
+
+	string& result = own(start, pos);
+
+	while (pos < end) {
+		const char* stop = scan.skipIdent(pos, end);
+		result.append(pos, stop);
+		pos = stop;
+
+		if (peek() == '\\' && peek(1) != '\n') {
+			pos++;
+			appendUtf8(result, consumeEscapedCodePoint());
 		}
 		else {
-			reader.unget();
 			break;
 		}
 	}
@@ -280,207 +415,199 @@ wstring Lexer::consumeIdent() {
 	return result;
 }
 
+/**
+ * @brief Checks whether the bytes at the read position would start an ident sequence
+ */
+
 bool Lexer::isIdentSequence() {
-    wchar_t next = reader.peek();
+	int next = peek();
 
 	if (next == '-') {
-		next = reader.ignore().peek();
-		reader.unget();
-
-		if (next == '-' || identStartCodePoint(next)) {
-			return true;
-		}
-		else if (next == '\\') {
-			next = reader.ignore().peek();
-			reader.unget();
-
-			if (reader.peek() != '\n') {
-				return true;
-			}
-		}
-	}
-
-	if (identStartCodePoint(next) || (next == '\\' && reader.peek() != '\n')) {
-		return true;
+		next = peek(1);
+		return next == '-' || identStartCodePoint(next) || (next == '\\' && peek(2) != '\n');
 	}
 
-	return false;
+	return identStartCodePoint(next) || (next == '\\' && peek(1) != '\n');
 }
 
 void Lexer::consumeHash() {
-	Token t(HASH, {}, COLUMN, line);
+	bool id = isIdentSequence();
+	Token t(HASH, consumeIdent(), offsetOf(mark));
 
-	if (isIdentSequence()) {
-		t.flags["type"] = L"id";
+	if (id) {
+		t.flags |= TF_ID;
 	}
 
-	t.lexeme = consumeIdent();
-	tokens.push_back(t);
+	emit(std::move(t));
 }
 
 void Lexer::consumeNumericToken() {
-	wstring numberType = L"integer";
-	wstring repr;
-
-    wchar_t next = reader.peek();
+	unsigned char numberType = 0;
+	const char* start = pos;
 
-	if (next == '+' || next == '-') {
-		repr += (wchar_t)reader.get();
-		next = reader.peek();
+	if (*pos == '+' || *pos == '-') {
+		pos++;
 	}
 
-	while (isdigit(next)) {
-		repr += (wchar_t)reader.get();
-		next = reader.peek();
+	while (isDigit(peek())) {
+		pos++;
 	}
 
-	if (next == '.') {
-		if (isdigit(reader.ignore().peek())) {
-			numberType = L"number";
-			repr += next;
-
-			while (isdigit(reader.peek())) {
-				repr += (wchar_t)reader.get();
-			}
+	if (peek() == '.' && isDigit(peek(1))) {
+		numberType = TF_NUMBER;
+		pos++;
 
-			next = reader.peek();
-		}
-		else {
-			reader.unget();
+		while (isDigit(peek())) {
+			pos++;
 		}
 	}
 
-	if (next == 'e' || next == 'E') {
-        wchar_t c = reader.ignore().peek();
+	if (peek() == 'e' || peek() == 'E') {
+		int sign = peek(1) == '+' || peek(1) == '-';
 
-		wstring suffix(1, next);
-		if (c == '+' || c == '-') {
-			reader.ignore();
-			suffix += c;
-		}
-
-		if (isdigit(reader.peek())) {
-			repr += suffix;
-			numberType = L"number";
+		if (isDigit(peek(1 + sign))) {
+			numberType = TF_NUMBER;
+			pos += 1 + sign;
 
-			while (isdigit(reader.peek())) {
-				repr += (wchar_t)reader.get();
+			while (isDigit(peek())) {
+				pos++;
 			}
 		}
-		else {
-			reader.unget();
-		}
 	}
 
+	string_view repr(start, pos - start);
 	TokenType type;
 
 	if (isIdentSequence()) {
 		type = DIMENSION;
 	}
-	else if (reader.peek() == '%') {
-		reader.ignore();
+	else if (peek() == '%') {
+		pos++;
 		type = PERCENTAGE;
 	}
 	else {
 		type = NUMBER;
 	}
 
-	Token t(type, repr, COLUMN, line);
-	t.flags["type"] = numberType;
+	Token t(type, repr, offsetOf(mark));
+	t.flags = numberType;
+
+	// from_chars does not take a leading '+'
+	const char* digits = *start == '+' ? start + 1 : start;
+
+	if (numberType == TF_NUMBER) {
+		if (std::from_chars(digits, repr.data() + repr.size(), t.value.number).ec == std::errc::result_out_of_range) {
+			size_t exponent = repr.find_first_of("eE");
+			bool underflow = exponent != string_view::npos && repr[exponent + 1] == '-';
+			t.value.number = std::copysign(underflow ? 0.0 : HUGE_VAL, *start == '-' ? -1.0 : 1.0);
+		}
+	}
+	else if (std::from_chars(digits, repr.data() + repr.size(), t.value.integer).ec == std::errc::result_out_of_range) {
+		t.value.integer = *start == '-' ? INT64_MIN : INT64_MAX;
+	}
 
 	if (type == DIMENSION) {
-		t.flags["unit"] = consumeIdent();
+		t.unit = internUnit(consumeIdent());
 	}
 
-	tokens.push_back(t);
+	emit(std::move(t));
 }
 
 void Lexer::consumeIdentLike() {
-	wstring s = consumeIdent();
+	string_view s = consumeIdent();
 
-	if (reader.peek() == '(') {
-		reader.ignore();
+	if (peek() == '(') {
+		pos++;
 
-		if (wstrcompi(s, L"url")) {
-			skipSpace();
+		if (keywordId(s) == KW_URL) {
+			consumeWhitespace();
 
-			if (reader.peek() == '"' || reader.peek() == '\'') {
-				tokens.emplace_back(FUNCTION, s, COLUMN, line);
+			if (peek() == '"' || peek() == '\'') {
+				addToken(FUNCTION, s);
 			}
 			else {
                 consumeUrl();
 			}
 		}
 		else {
-			tokens.emplace_back(FUNCTION, s, COLUMN, line);
+			addToken(FUNCTION, s);
 		}
 	}
 	else {
-		tokens.emplace_back(IDENT, s, COLUMN, line);
+		addToken(IDENT, s);
 	}
 }
 
-void Lexer::skipSpace() {
-	while (isSpace(reader.peek())) {
-        if (reader.peek() == '\n') {
-            posOffset = (int)reader.tellg();
-            line++;
-        }
+void Lexer::consumeUrl() {
+	Token t(URL, {}, offsetOf(mark));
+	const char* start = pos;
+	string* owned = nullptr;
 
-        reader.ignore();
-    }
-}
+	while (pos < end) {
+		const char* stop = scan.findUrlStop(pos, end);
 
-void Lexer::consumeUrl() {
-	Token t(URL, {}, COLUMN, line);
+		if (owned) {
+			owned->append(pos, stop);
+		}
 
-	while (true) {
-		int c = reader.get();
+		if ((pos = stop) == end) {
+			break;
+		}
 
-		switch (c) {
-			case EOF:
-			case ')': tokens.push_back(t); return;
-            case '\n': {
-                posOffset = (int)reader.tellg();
-                line++;
-            }
-			case ' ': case '\t': break;
+		switch (*pos++) {
+			case ')': {
+				t.lexeme = owned ? string_view(*owned) : string_view(start, pos - 1 - start);
+				emit(std::move(t));
+				return;
+			}
+			case '\n': newline(pos - 1);
+			case ' ': case '\t': {
+				if (!owned) {
+					owned = &own(start, pos - 1);
+				}
+				break;
+			}
 			case '"':
 			case '\'':
 			case '(': {
                 consumeBadUrl();
-                addToken(BAD_URL);
+                addToken(BAD_URL, {});
 				return;
 			}
 			case '\\': {
-				if (reader.peek() != '\n') {
-					t.lexeme += consumeEscapedCodePoint();
+				if (peek() != '\n') {
+					if (!owned) {
+						owned = &own(start, pos - 1);
+					}
+
+					appendUtf8(*owned, consumeEscapedCodePoint());
 				}
 				else {
                     consumeBadUrl();
-                    addToken(BAD_URL);
+                    addToken(BAD_URL, {});
 					return;
 				}
 				break;
 			}
-			default: t.lexeme += static_cast<wchar_t>(c); break;
+			default: break;
 		}
 	}
+
+	t.lexeme = owned ? string_view(*owned) : string_view(start, pos - start);
+	emit(std::move(t));
 }
 
 void Lexer::consumeBadUrl() {
-	while (true) {
-		int c = reader.get();
-
-		switch (c) {
+	while (pos < end) {
+		switch (*pos++) {
 			case ')': return;
+			case '\n': newline(pos - 1); break;
 			case '\\': {
-				if (reader.peek() != '\n') {
+				if (peek() != '\n') {
                     consumeEscapedCodePoint();
 				}
 				break;
 			}
-            case EOF: return;
             default: break;
 		}
 	}
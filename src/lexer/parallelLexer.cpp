@@ -0,0 +1,103 @@
+#include <hcss/lexer/parallelLexer.hpp>
+#include <hcss/lexer/structuralIndex.hpp>
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+// Below this many bytes per chunk the hand-off costs more than the lexing it spreads out
+constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * @brief Lexes the buffer on the pool and stitches the chunks back together
+ *
+ * @return vector<Token>& The same tokens Lexer::lex() would produce, ending with T_EOF
+ */
+
+vector<Token>& ParallelLexer::lex() {
+	if ((uint64_t) (end - begin) >= NO_SOURCE_OFFSET) {
+		throw std::length_error("Source is too large for 32-bit offsets. Build with HCSS_LARGE_FILES.");
+	}
+
+	size_t chunks = std::max<size_t>(1, std::min<size_t>(pool.size(), (end - begin) / MIN_CHUNK_SIZE));
+	vector<const char*> splits = splitPoints(chunks);
+	vector<std::future<void>> jobs;
+
+	for (size_t i = 0; i + 1 < splits.size(); i++) {
+		Lexer& lexer = lexers.emplace_back(splits[i], end);
+		lexer.offsetBase = (SourceOffset) (splits[i] - begin);
+		const char* to = splits[i + 1];
+
+		if (splits.size() > 2) {
+			jobs.push_back(pool.submit([&lexer, to] { while (lexer.pos < to) lexer.lexToken(); }));
+		}
+		else {
+			while (lexer.pos < to) lexer.lexToken();
+		}
+	}
+
+	for (std::future<void>& job : jobs) {
+		job.get();
+	}
+
+	// A chunk is only valid if its predecessor stopped exactly on its first byte. Otherwise the split was inside a token
+	// after all, and the chunk is lexed again from where the predecessor got to.
+	size_t count = lexers.size();
+	const char* reached = begin;
+	lines.starts.resize(1);
+
+	for (size_t i = 0; i < count; i++) {
+		Lexer* lexer = &lexers[i];
+
+		if (lexer->begin != reached) {
+			lexer = &lexers.emplace_back(reached, end);
+			lexer->offsetBase = (SourceOffset) (reached - begin);
+			while (lexer->pos < splits[i + 1]) lexer->lexToken();
+		}
+
+		tokens.insert(tokens.end(), std::make_move_iterator(lexer->tokens.begin()), std::make_move_iterator(lexer->tokens.end()));
+		lines.starts.insert(lines.starts.end(), lexer->lines.starts.begin() + 1, lexer->lines.starts.end());
+		lexer->tokens.clear();
+		reached = std::max(reached, lexer->pos);
+	}
+
+	tokens.emplace_back(T_EOF, string_view {}, (SourceOffset) (end - begin));
+	return tokens;
+}
+
+/**
+ * @brief Finds where to cut the buffer: after the first '}' in the structural index past each chunk's share of it. The
+ * index has already skipped strings, comments, urls and escapes.
+ *
+ * @param chunks The number of chunks wanted
+ * @return vector<const char*> 'begin', the split points and 'end'. There are fewer chunks if no '}' is found in time.
+ */
+
+vector<const char*> ParallelLexer::splitPoints(size_t chunks) const {
+	vector<const char*> splits { begin };
+
+	if (chunks < 2) {
+		splits.push_back(end);
+		return splits;
+	}
+
+	StructuralIndex index(begin, end);
+	size_t size = end - begin;
+	size_t i = 0;
+
+	for (size_t k = 1; k < chunks; k++) {
+		i = std::max(i, index.find((SourceOffset) (size * k / chunks)));
+
+		while (i < index.size() && index.at(i) != '}') {
+			i++;
+		}
+
+		if (i == index.size()) {
+			break;
+		}
+
+		splits.push_back(begin + index.offsets[i++] + 1);
+	}
+
+	splits.push_back(end);
+	return splits;
+}
@@ -0,0 +1,205 @@
+#include <hcss/lexer/scan.hpp>
+#include <hcss/lexer/charClass.hpp>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define HCSS_SCAN_X86
+#endif
+
+#pragma region Scalar
+
+namespace scalar {
+	const char* skipWhitespace(const char* p, const char* end) {
+		while (p < end && hasClass((unsigned char) *p, CC_SPACE)) {
+			p++;
+		}
+
+		return p;
+	}
+
+	const char* skipIdent(const char* p, const char* end) {
+		while (p < end && hasClass((unsigned char) *p, CC_IDENT)) {
+			p++;
+		}
+
+		return p;
+	}
+
+	const char* findCommentEnd(const char* p, const char* end) {
+		for (; end - p >= 2; p++) {
+			if (p[0] == '*' && p[1] == '/') {
+				return p;
+			}
+		}
+
+		return end;
+	}
+
+	const char* findStringStop(const char* p, const char* end, char quote) {
+		while (p < end && *p != quote && *p != '\\' && *p != '\n') {
+			p++;
+		}
+
+		return p;
+	}
+
+	const char* findUrlStop(const char* p, const char* end) {
+		for (; p < end; p++) {
+			switch (*p) {
+				case ')': case '(': case '\\': case '"': case '\'':
+				case ' ': case '\t': case '\n': return p;
+				default: break;
+			}
+		}
+
+		return p;
+	}
+
+	void recordNewlines(const char* p, const char* end, SourceOffset base, std::vector<SourceOffset>& starts) {
+		for (const char* origin = p; p < end; p++) {
+			if (*p == '\n') {
+				starts.push_back(base + (SourceOffset) (p - origin + 1));
+			}
+		}
+	}
+
+	const char* recordStructurals(const char* p, const char* end, SourceOffset base, std::vector<SourceOffset>& out) {
+		for (const char* origin = p; p < end; p++) {
+			switch (*p) {
+				case '{': case '}': case '[': case ']':
+				case '(': case ')': case ';': case ',': {
+					out.push_back(base + (SourceOffset) (p - origin));
+					break;
+				}
+				case '"': case '\'': case '\\': case '/': return p;
+				default: break;
+			}
+		}
+
+		return p;
+	}
+
+	const ScanKernels kernels = {
+		SCAN_SCALAR,
+		skipWhitespace,
+		skipIdent,
+		findCommentEnd,
+		findStringStop,
+		findUrlStop,
+		recordNewlines,
+		recordStructurals
+	};
+}
+
+#pragma endregion
+
+#ifdef HCSS_SCAN_X86
+
+#pragma region SSE2
+
+namespace sse2 {
+	struct Simd {
+		using Vec = __m128i;
+		using Mask = unsigned;
+		static constexpr int width = 16;
+		static constexpr Mask full = 0xFFFF;
+		static constexpr ScanLevel level = SCAN_SSE2;
+
+		static Vec load(const char* p) { return _mm_loadu_si128((const __m128i*) p); }
+		static Vec eq(Vec v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+		static Vec both(Vec a, Vec b) { return _mm_and_si128(a, b); }
+		static Vec any(Vec a, Vec b, Vec c) { return _mm_or_si128(_mm_or_si128(a, b), c); }
+		static Vec lower(Vec v) { return _mm_or_si128(v, _mm_set1_epi8(0x20)); }
+		static Vec nonAscii(Vec v) { return _mm_cmplt_epi8(v, _mm_setzero_si128()); }
+		static Mask mask(Vec v) { return (Mask) _mm_movemask_epi8(v); }
+
+		// Unsigned lo <= v <= hi, built from the unsigned min/max SSE2 does have
+		static Vec between(Vec v, char lo, char hi) {
+			return _mm_and_si128(
+				_mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(lo)), v),
+				_mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(hi)), v)
+			);
+		}
+	};
+
+	#include "scanKernels.inc"
+}
+
+#pragma endregion
+
+#pragma region AVX2
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+	struct Simd {
+		using Vec = __m256i;
+		using Mask = unsigned;
+		static constexpr int width = 32;
+		static constexpr Mask full = 0xFFFFFFFF;
+		static constexpr ScanLevel level = SCAN_AVX2;
+
+		static Vec load(const char* p) { return _mm256_loadu_si256((const __m256i*) p); }
+		static Vec eq(Vec v, char c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); }
+		static Vec both(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+		static Vec any(Vec a, Vec b, Vec c) { return _mm256_or_si256(_mm256_or_si256(a, b), c); }
+		static Vec lower(Vec v) { return _mm256_or_si256(v, _mm256_set1_epi8(0x20)); }
+		static Vec nonAscii(Vec v) { return _mm256_cmpgt_epi8(_mm256_setzero_si256(), v); }
+		static Mask mask(Vec v) { return (Mask) _mm256_movemask_epi8(v); }
+
+		static Vec between(Vec v, char lo, char hi) {
+			return _mm256_and_si256(
+				_mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(lo)), v),
+				_mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(hi)), v)
+			);
+		}
+	};
+
+	#include "scanKernels.inc"
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#pragma endregion
+
+#endif
+
+#pragma region Dispatch
+
+/**
+ * @brief Returns the kernels for 'level', or for the best level below it that this CPU supports
+ */
+
+const ScanKernels& scanKernels(ScanLevel level) {
+#ifdef HCSS_SCAN_X86
+	if (level >= SCAN_AVX2 && __builtin_cpu_supports("avx2")) {
+		return avx2::kernels;
+	}
+
+	if (level >= SCAN_SSE2) {
+		return sse2::kernels;
+	}
+#endif
+
+	return scalar::kernels;
+}
+
+/**
+ * @brief Returns the best kernels this CPU supports. Detection runs once.
+ */
+
+const ScanKernels& scanKernels() {
+	static const ScanKernels& best = scanKernels(SCAN_AVX2);
+	return best;
+}
+
+#pragma endregion
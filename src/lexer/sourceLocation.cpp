@@ -0,0 +1,18 @@
+#include <hcss/lexer/sourceLocation.hpp>
+#include <algorithm>
+
+/**
+ * @brief Finds the line and column of a byte offset
+ *
+ * @param offset A byte offset into the source the index was built from
+ * @return SourceLocation The location, or { -1, -1 } for NO_SOURCE_OFFSET
+ */
+
+SourceLocation LineIndex::locate(SourceOffset offset) const {
+	if (offset == NO_SOURCE_OFFSET) {
+		return { -1, -1 };
+	}
+
+	auto line = std::upper_bound(starts.begin(), starts.end(), offset) - 1;
+	return { firstLine + (line - starts.begin()), (int64_t) (offset - *line) };
+}
@@ -0,0 +1,190 @@
+#include <hcss/lexer/structuralIndex.hpp>
+#include <hcss/lexer/charClass.hpp>
+#include <hcss/lexer/scan.hpp>
+#include <algorithm>
+
+bool isUrlParen(const char* begin, const char* paren) {
+	if (paren - begin < 3) {
+		return false;
+	}
+
+	const char* s = paren - 3;
+
+	if ((s[0] | 0x20) != 'u' || (s[1] | 0x20) != 'r' || (s[2] | 0x20) != 'l') {
+		return false;
+	}
+
+	// "xurl(", "-url(", "#url(" and "@url(" continue a longer ident, hash or at-keyword
+	return s == begin || !(hasClass((unsigned char) s[-1], CC_IDENT) || s[-1] == '\\' || s[-1] == '#' || s[-1] == '@');
+}
+
+/**
+ * @brief Indexes [begin, end). The kernels record structurals in bulk and stop at every byte that may start a string,
+ * comment or escape, which is stepped over here before the bulk scan resumes.
+ */
+
+StructuralIndex::StructuralIndex(const char* begin, const char* end)
+	: begin(begin)
+{
+	const ScanKernels& scan = scanKernels();
+	const char* p = begin;
+
+	while (p < end) {
+		size_t from = offsets.size();
+		const char* stop = scan.recordStructurals(p, end, (SourceOffset) (p - begin), offsets);
+
+		// An unquoted url( is a single token, so whatever the bulk scan recorded from its '(' on is dropped
+		for (size_t i = from; i < offsets.size(); i++) {
+			const char* paren = begin + offsets[i];
+
+			if (*paren != '(' || !isUrlParen(begin, paren)) {
+				continue;
+			}
+
+			const char* q = scan.skipWhitespace(paren + 1, end);
+
+			if (q < end && (*q == '"' || *q == '\'')) {
+				continue;
+			}
+
+			offsets.resize(i);
+
+			while ((q = scan.findUrlStop(q, end)) < end) {
+				char c = *q++;
+
+				if (c == ')') {
+					break;
+				}
+				else if (c == '\\' && q < end) {
+					q++;
+				}
+			}
+
+			stop = nullptr;
+			p = q;
+			break;
+		}
+
+		if (!stop) {
+			continue;
+		}
+
+		if ((p = stop) == end) {
+			break;
+		}
+
+		char c = *p++;
+
+		switch (c) {
+			case '"': case '\'': {
+				while ((p = scan.findStringStop(p, end, c)) < end) {
+					char s = *p++;
+
+					// An unescaped newline ends a bad string
+					if (s == c || s == '\n') {
+						break;
+					}
+					else if (p < end) {
+						p++;
+					}
+				}
+				break;
+			}
+			case '/': {
+				if (p < end && *p == '*') {
+					const char* close = scan.findCommentEnd(p + 1, end);
+					p = close == end ? end : close + 2;
+				}
+				break;
+			}
+			case '\\': {
+				// The escaped byte is part of an ident, even if it is a quote or a bracket
+				if (p < end) {
+					p++;
+				}
+				break;
+			}
+		}
+	}
+
+	matchBrackets();
+}
+
+/**
+ * @brief Pairs every closer with the innermost open bracket if it is of the same kind
+ */
+
+void StructuralIndex::matchBrackets() {
+	vector<SourceOffset> open;
+	matches.assign(offsets.size(), NO_MATCH);
+
+	for (SourceOffset i = 0; i < offsets.size(); i++) {
+		char c = at(i);
+
+		switch (c) {
+			case '{': case '[': case '(': {
+				open.push_back(i);
+				break;
+			}
+			case '}': case ']': case ')': {
+				if (open.empty()) {
+					break;
+				}
+
+				char opener = at(open.back());
+
+				if ((opener == '{' && c == '}') || (opener == '[' && c == ']') || (opener == '(' && c == ')')) {
+					matches[i] = open.back();
+					matches[open.back()] = i;
+					open.pop_back();
+				}
+				break;
+			}
+			default: break;
+		}
+	}
+}
+
+/**
+ * @return size_t The index of the first structural at or after 'offset', size() if there is none
+ */
+
+size_t StructuralIndex::find(SourceOffset offset) const {
+	return std::lower_bound(offsets.begin(), offsets.end(), offset) - offsets.begin();
+}
+
+/**
+ * @brief Skips from entry 'i' to the structural that ends the rule or declaration it is in: the first ';' at the same
+ * level, the '}' that closes the first '{' block, or the closer of an enclosing block
+ *
+ * @return size_t The index of that structural, size() if the input ends first
+ */
+
+size_t StructuralIndex::ruleEnd(size_t i) const {
+	while (i < offsets.size()) {
+		switch (at(i)) {
+			case ';': return i;
+			case '{': return matches[i] == NO_MATCH ? offsets.size() : matches[i];
+			case '[': case '(': {
+				if (matches[i] == NO_MATCH) {
+					return offsets.size();
+				}
+
+				i = matches[i] + 1;
+				break;
+			}
+			case '}': case ']': case ')': {
+				// A stray closer is an ordinary token
+				if (matches[i] == NO_MATCH) {
+					i++;
+					break;
+				}
+
+				return i;
+			}
+			default: i++; break;
+		}
+	}
+
+	return offsets.size();
+}
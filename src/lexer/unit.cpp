@@ -0,0 +1,88 @@
+#include <hcss/lexer/unit.hpp>
+#include <hcss/lexer/keyword.hpp>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+	struct UnitTable {
+		// deque keeps the names in place, so the views handed out by unitName stay valid
+		std::deque<std::string> names;
+		std::unordered_map<std::string_view, UnitId> ids;
+		std::shared_mutex mutex;
+
+		UnitTable() {
+			for (const char* name : { "", "px", "em", "rem", "ex", "ch", "vw", "vh", "vmin", "vmax", "cm", "mm", "q", "in",
+				"pt", "pc", "deg", "grad", "rad", "turn", "s", "ms", "hz", "khz", "dpi", "dpcm", "dppx", "x", "fr" }) {
+				auto id = (UnitId) names.size();
+				ids.emplace(names.emplace_back(name), id);
+			}
+		}
+	};
+
+	UnitTable& table() {
+		static UnitTable units;
+		return units;
+	}
+}
+
+/**
+ * @brief Returns the id for a unit name. Units are ASCII case-insensitive, so "PX" and "px" share an id. Known units
+ * @brief come straight from the keyword table without taking the lock.
+ *
+ * @param name The unit as written after the number
+ * @return UnitId The unit's id, interning it if it has not been seen before
+ */
+
+UnitId internUnit(std::string_view name) {
+	static_assert(KW_FR - KW_PX == UNIT_FR - UNIT_PX);
+
+	if (Keyword id = keywordId(name); id >= KW_PX && id <= KW_FR) {
+		return (UnitId) (UNIT_PX + (id - KW_PX));
+	}
+
+	std::string key(name);
+
+	for (char& c : key) {
+		if (c >= 'A' && c <= 'Z') {
+			c |= 0x20;
+		}
+	}
+
+	UnitTable& units = table();
+
+	{
+		std::shared_lock lock(units.mutex);
+
+		if (auto it = units.ids.find(key); it != units.ids.end()) {
+			return it->second;
+		}
+	}
+
+	std::unique_lock lock(units.mutex);
+
+	if (auto it = units.ids.find(key); it != units.ids.end()) {
+		return it->second;
+	}
+
+	if (units.names.size() > UINT16_MAX) {
+		throw std::length_error("Too many distinct units");
+	}
+
+	auto id = (UnitId) units.names.size();
+	units.ids.emplace(units.names.emplace_back(std::move(key)), id);
+	return id;
+}
+
+/**
+ * @brief Returns the lowercase name of an interned unit
+ */
+
+std::string_view unitName(UnitId id) {
+	UnitTable& units = table();
+	std::shared_lock lock(units.mutex);
+	return id < units.names.size() ? std::string_view(units.names[id]) : std::string_view();
+}
@@ -0,0 +1,129 @@
+#include <hcss/parser/blockBuilder.hpp>
+#include <iterator>
+#include <utility>
+
+/**
+ * @brief Appends a value to the innermost open node, or to the top level if there is none
+ */
+
+void BlockBuilder::append(ComponentValue&& value) {
+    if (frames.empty()) {
+        values.push_back(std::move(value));
+    }
+    else {
+        pending.push_back(std::move(value));
+    }
+}
+
+/**
+ * @brief Closes the innermost open node and appends it to its parent
+ *
+ * @param token The closing token, or nullopt if the node is closed by EOF
+ */
+
+void BlockBuilder::close(std::optional<Token> token) {
+    Frame frame = std::move(frames.back());
+    frames.pop_back();
+
+    if (frame.unwalked && !frames.empty()) {
+        frames.back().unwalked = true;
+    }
+
+    auto take = [&](size_t from, size_t to) {
+        return NodeList<ComponentValue>(std::make_move_iterator(pending.begin() + from), std::make_move_iterator(pending.begin() + to));
+    };
+
+    if (frame.open.type == FUNCTION) {
+        FunctionCall call { std::move(frame.open) };
+
+        if (frame.start < pending.size() || !frame.commas.empty()) {
+            size_t from = frame.start;
+
+            for (size_t comma : frame.commas) {
+                call.arguments.push_back(take(from, comma));
+                from = comma;
+            }
+
+            call.arguments.push_back(take(from, pending.size()));
+
+            // Parser::consumeCommaList does not start an argument for a leading comma. Unwalked calls keep it so the
+            // parser gets back the exact token list.
+            if (!frame.unwalked && call.arguments.front().empty()) {
+                call.arguments.erase(call.arguments.begin());
+            }
+        }
+
+        call.unwalked = frame.unwalked;
+        pending.resize(frame.start);
+        append(std::move(call));
+    }
+    else {
+        SimpleBlock block { std::move(frame.open), take(frame.start, pending.size()), std::move(token), frame.unwalked };
+        pending.resize(frame.start);
+        append(std::move(block));
+    }
+}
+
+/**
+ * @brief Adds the next token to the tree
+ */
+
+void BlockBuilder::push(Token&& t) {
+    Frame* frame = frames.empty() ? nullptr : &frames.back();
+    bool call = frame && frame->open.type == FUNCTION;
+
+    switch (t.type) {
+        case T_EOF: {
+            while (!frames.empty()) {
+                close(std::nullopt);
+            }
+
+            values.push_back(std::move(t));
+            return;
+        }
+        case LEFT_PAREN: {
+            if (call) {
+                frame->parens++;
+                break;
+            }
+        }
+        case FUNCTION: case LEFT_BRACE: case LEFT_BRACKET: {
+            frames.push_back({ std::move(t), pending.size() });
+            return;
+        }
+        case RIGHT_PAREN: {
+            if (call) {
+                if (frame->parens == 0) {
+                    close(std::nullopt);
+                    return;
+                }
+
+                frame->parens--;
+                break;
+            }
+        }
+        case RIGHT_BRACE: case RIGHT_BRACKET: {
+            if (frame && !call && t.type == (frame->open.type == LEFT_BRACE ? RIGHT_BRACE : frame->open.type == LEFT_BRACKET ? RIGHT_BRACKET : RIGHT_PAREN)) {
+                close(std::move(t));
+                return;
+            }
+            break;
+        }
+        case COMMA: {
+            if (call && frame->parens == 0) {
+                frame->commas.push_back(pending.size());
+                return;
+            }
+            break;
+        }
+        case DELIM: {
+            if (frame && t.lexeme[0] == '$') {
+                frame->unwalked = true;
+            }
+            break;
+        }
+        default: break;
+    }
+
+    append(std::move(t));
+}
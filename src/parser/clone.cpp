@@ -0,0 +1,161 @@
+#include <hcss/parser/clone.hpp>
+#include <type_traits>
+
+template<typename List>
+static List cloneAll(const List& list) {
+    List copy;
+    copy.reserve(list.size());
+
+    for (const auto& item : list) {
+        copy.emplace_back(clone(item));
+    }
+
+    return copy;
+}
+
+/**
+ * @brief Copies a variant whose alternatives are either copyable (tokens, monostate) or have a clone() overload
+ */
+
+template<typename Variant>
+static Variant cloneVariant(const Variant& variant) {
+    return std::visit([](const auto& v) -> Variant {
+        using T = std::decay_t<decltype(v)>;
+
+        if constexpr (std::is_same_v<T, std::monostate> || std::is_same_v<T, Token>) {
+            return v;
+        }
+        else {
+            return clone(v);
+        }
+    }, variant);
+}
+
+ComponentValue clone(const ComponentValue& value) {
+    return cloneVariant(value);
+}
+
+NodeList<ComponentValue> clone(const NodeList<ComponentValue>& values) {
+    return cloneAll(values);
+}
+
+SyntaxNode clone(const SyntaxNode& node) {
+    return cloneVariant(node);
+}
+
+StyleBlockVariant clone(const StyleBlockVariant& item) {
+    return cloneVariant(item);
+}
+
+StyleBlock clone(const StyleBlock& block) {
+    return cloneAll(block);
+}
+
+SimpleBlock clone(const SimpleBlock& block) {
+    return SimpleBlock(block.open, clone(block.value), block.close, block.unwalked);
+}
+
+FunctionCall clone(const FunctionCall& call) {
+    return { call.name, cloneAll(call.arguments), call.unwalked };
+}
+
+FunctionDefinition clone(const FunctionDefinition& function) {
+    FunctionDefinition copy(function.name);
+    copy.parameters.reserve(function.parameters.size());
+
+    for (const auto& [name, fallback] : function.parameters) {
+        copy.parameters.emplace_back(name, clone(fallback));
+    }
+
+    return copy;
+}
+
+AtRule clone(const AtRule& rule) {
+    return AtRule(rule.name, clone(rule.prelude), rule.block ? std::optional(clone(*rule.block)) : std::nullopt);
+}
+
+QualifiedRule clone(const QualifiedRule& rule) {
+    return { clone(rule.prelude), rule.block ? std::optional(clone(*rule.block)) : std::nullopt };
+}
+
+StyleRule clone(const StyleRule& rule) {
+    return StyleRule(clone(rule.selectors), clone(rule.block));
+}
+
+Declaration clone(const Declaration& declaration) {
+    return { declaration.name, declaration.colon, cloneAll(declaration.value), declaration.important };
+}
+
+PseudoClassSelector clone(const PseudoClassSelector& selector) {
+    return {
+        selector.colon,
+        selector.tok,
+        selector.anyValue ? std::optional(clone(*selector.anyValue)) : std::nullopt,
+        selector.closeParen
+    };
+}
+
+CompoundSelector clone(const CompoundSelector& selector) {
+    CompoundSelector copy { selector.typeSelector };
+    copy.subclassSelectors.reserve(selector.subclassSelectors.size());
+    copy.pseudoSelectors.reserve(selector.pseudoSelectors.size());
+
+    for (const SubclassSelector& subclass : selector.subclassSelectors) {
+        copy.subclassSelectors.emplace_back(std::visit([](const auto& v) -> SubclassSelector {
+            if constexpr (std::is_same_v<std::decay_t<decltype(v)>, PseudoClassSelector>) {
+                return clone(v);
+            }
+            else {
+                return v;
+            }
+        }, subclass));
+    }
+
+    for (const auto& [element, classes] : selector.pseudoSelectors) {
+        copy.pseudoSelectors.emplace_back(PseudoElementSelector { element.colon, clone(element.selector) }, cloneAll(classes));
+    }
+
+    return copy;
+}
+
+ComplexSelector clone(const ComplexSelector& selector) {
+    ComplexSelector copy;
+    copy.reserve(selector.size());
+
+    for (const auto& [combinator, compound] : selector) {
+        copy.emplace_back(combinator, clone(compound));
+    }
+
+    return copy;
+}
+
+ComplexSelectorList clone(const ComplexSelectorList& selectors) {
+    return cloneAll(selectors);
+}
+
+/**
+ * @return size_t How many values clone() copies for 'values', counting those inside functions, blocks and rules
+ */
+
+size_t countNodes(const NodeList<ComponentValue>& values) {
+    size_t count = values.size();
+
+    for (const ComponentValue& value : values) {
+        if (auto call = std::get_if<FunctionCall>(&value)) {
+            for (const auto& argument : call->arguments) {
+                count += countNodes(argument);
+            }
+        }
+        else if (auto block = std::get_if<SimpleBlock>(&value)) {
+            count += countNodes(block->value);
+        }
+        else if (auto rule = std::get_if<AtRule>(&value)) {
+            count += countNodes(rule->prelude) + (rule->block ? countNodes(rule->block->value) : 0);
+        }
+        else if (auto rule = std::get_if<QualifiedRule>(&value)) {
+            count += countNodes(rule->prelude) + (rule->block ? countNodes(rule->block->value) : 0);
+        }
+    }
+
+    return count;
+}
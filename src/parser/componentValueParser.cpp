@@ -3,8 +3,67 @@
 
 #include <hcss/parser/componentValueParser.hpp>
 #include <hcss/util/util.hpp>
+#include <algorithm>
 #include <utility>
 
+// Extra slots opened in front of the cursor when prepend() runs out of consumed ones
+constexpr size_t PREPEND_SLACK = 256;
+
+/**
+ * @brief Pulls from 'source' until at least 'count' values are buffered
+ *
+ * @param count The number of values needed
+ * @return true If there are that many values
+ * @return false If the input ended first
+ */
+
+bool ComponentValueParser::fill(size_t count) {
+    while (remaining() < count) {
+        if (!source) {
+            return false;
+        }
+
+        // Drop the consumed values first so the buffer only ever holds what is still to be parsed
+        values.erase(values.begin(), values.begin() + pos);
+        shift -= (int64_t) pos;
+        pos = 0;
+
+        if (!source->pull(values)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Makes room for 'count' values in front of the cursor. Consumed slots are reused when there are enough of them.
+ */
+
+void ComponentValueParser::reserveFront(size_t count) {
+    if (pos >= count) {
+        return;
+    }
+
+    // Leave some slack so expanding nested variables does not shift the buffer every time. Consuming frees slots too,
+    // so the slack does not have to grow with the buffer.
+    size_t gap = count + PREPEND_SLACK;
+    size_t size = values.size();
+    values.resize(size + gap);
+    std::move_backward(values.begin() + pos, values.begin() + size, values.end());
+    pos += gap;
+    shift += (int64_t) gap;
+}
+
+/**
+ * @brief Puts 'value' back in front of the cursor
+ */
+
+void ComponentValueParser::prepend(ComponentValue&& value) {
+    reserveFront(1);
+    values[--pos] = std::move(value);
+}
+
 /**
  * @brief Consumes the next ComponentValue
  * 
@@ -12,10 +71,11 @@
  */
 
 ComponentValue ComponentValueParser::consume() {
-    auto temp = std::move(values.front());
-    values.pop_front();
+    if (!more()) {
+        SYNTAX_ERROR("Unexpected end of input", nullopt);
+    }
 
-    return temp;
+    return std::move(values[pos++]);
 }
 
 /**
@@ -38,14 +98,14 @@ Token ComponentValueParser::consume(TokenType type, const string& error) {
 }
 
 /**
- * @brief Peeks the next ComponentValue
+ * @brief Peeks the next ComponentValue without copying it
  * 
- * @return The next ComponentValue on success
- * @return nullopt on failure
+ * @return ComponentValue* The value in the buffer on success
+ * @return nullptr on failure
  */
 
-optional<ComponentValue> ComponentValueParser::peek(int idx) {
-    return !values.empty() && idx < values.size() ? optional<ComponentValue>(values[idx]) : nullopt;
+ComponentValue* ComponentValueParser::peek(size_t idx) {
+    return idx < remaining() || fill(idx + 1) ? &values[pos + idx] : nullptr;
 }
 
 /**
@@ -57,17 +117,17 @@ optional<ComponentValue> ComponentValueParser::peek(int idx) {
  * @return false If the token at 'idx' does not match the given type
  */
 
-bool ComponentValueParser::check(TokenType type, int idx) {
+bool ComponentValueParser::check(TokenType type, size_t idx) {
     auto t = peek<Token>(idx);
     return t && t->type == type;
 }
 
-bool ComponentValueParser::check(const wstring& lexeme, int idx) {
+bool ComponentValueParser::check(string_view lexeme, size_t idx) {
     auto t = peek<Token>(idx);
     return t && t->lexeme == lexeme;
 }
 
-bool ComponentValueParser::check(const wchar_t& lexeme, int idx) {
+bool ComponentValueParser::check(char lexeme, size_t idx) {
     auto t = peek<Token>(idx);
     return t && t->type == DELIM && t->lexeme[0] == lexeme;
 }
@@ -0,0 +1,321 @@
+#include <hcss/parser/flatTree.hpp>
+#include <type_traits>
+
+/**
+ * @brief Flattens parser output. Monostate values (consumed variables) are left out.
+ *
+ * @param rules The rules from Parser::parse or Stylesheet::parse
+ */
+
+FlatTree::FlatTree(const NodeList<SyntaxNode>& rules) {
+    uint32_t last = FlatNode::NONE;
+
+    for (const SyntaxNode& rule : rules) {
+        uint32_t node = add(rule);
+
+        if (node == FlatNode::NONE) {
+            continue;
+        }
+        else if (last != FlatNode::NONE) {
+            nodes[last].nextSibling = node;
+        }
+
+        last = node;
+    }
+}
+
+/**
+ * @return const Token* The token of 'node', nullptr if it has none
+ */
+
+const Token* FlatTree::token(uint32_t node) const {
+    uint32_t t = nodes[node].token;
+    return t == FlatNode::NONE ? nullptr : &tokens[t];
+}
+
+void FlatTree::Siblings::push(uint32_t child) {
+    if (child == FlatNode::NONE) {
+        return;
+    }
+    else if (last == FlatNode::NONE) {
+        tree.nodes[parent].firstChild = child;
+    }
+    else {
+        tree.nodes[last].nextSibling = child;
+    }
+
+    last = child;
+}
+
+uint32_t FlatTree::append(FlatKind kind, const Token* token) {
+    FlatNode node { kind };
+
+    if (token) {
+        node.token = (uint32_t) tokens.size();
+        tokens.push_back(*token);
+    }
+
+    nodes.push_back(node);
+    return (uint32_t) nodes.size() - 1;
+}
+
+uint32_t FlatTree::add(const SyntaxNode& node) {
+    return std::visit([this](const auto& v) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::monostate>) {
+            return FlatNode::NONE;
+        }
+        else {
+            return add(v);
+        }
+    }, node);
+}
+
+uint32_t FlatTree::add(const ComponentValue& value) {
+    return std::visit([this](const auto& v) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::monostate>) {
+            return FlatNode::NONE;
+        }
+        else {
+            return add(v);
+        }
+    }, value);
+}
+
+uint32_t FlatTree::add(const StyleBlockVariant& item) {
+    return std::visit([this](const auto& v) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::monostate>) {
+            return FlatNode::NONE;
+        }
+        else {
+            return add(v);
+        }
+    }, item);
+}
+
+uint32_t FlatTree::add(const Token& t) {
+    return append(FK_TOKEN, &t);
+}
+
+uint32_t FlatTree::add(const SimpleBlock& block) {
+    uint32_t node = append(FK_BLOCK, &block.open);
+    Siblings children { *this, node };
+
+    for (const ComponentValue& value : block.value) {
+        children.push(add(value));
+    }
+
+    if (block.close) {
+        children.push(add(*block.close));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const FunctionCall& call) {
+    uint32_t node = append(FK_FUNCTION, &call.name);
+    Siblings arguments { *this, node };
+
+    for (const NodeList<ComponentValue>& argument : call.arguments) {
+        uint32_t arg = append(FK_ARGUMENT);
+        Siblings children { *this, arg };
+
+        for (const ComponentValue& value : argument) {
+            children.push(add(value));
+        }
+
+        arguments.push(arg);
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::addPrelude(const NodeList<ComponentValue>& prelude) {
+    uint32_t node = append(FK_PRELUDE);
+    Siblings children { *this, node };
+
+    for (const ComponentValue& value : prelude) {
+        children.push(add(value));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const AtRule& rule) {
+    uint32_t node = append(FK_AT_RULE, &rule.name);
+    Siblings children { *this, node };
+    children.push(addPrelude(rule.prelude));
+
+    if (rule.block) {
+        children.push(add(*rule.block));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const QualifiedRule& rule) {
+    uint32_t node = append(FK_QUALIFIED_RULE);
+    Siblings children { *this, node };
+    children.push(addPrelude(rule.prelude));
+
+    if (rule.block) {
+        children.push(add(*rule.block));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const StyleRule& rule) {
+    uint32_t node = append(FK_STYLE_RULE);
+    Siblings children { *this, node };
+
+    for (const ComplexSelector& selector : rule.selectors) {
+        children.push(add(selector));
+    }
+
+    for (const StyleBlockVariant& item : rule.block) {
+        children.push(add(item));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const Declaration& declaration) {
+    uint32_t node = append(FK_DECLARATION, &declaration.name);
+    Siblings children { *this, node };
+
+    if (declaration.important) {
+        nodes[node].flags |= FF_IMPORTANT;
+    }
+
+    for (const ComponentValue& value : declaration.value) {
+        children.push(add(value));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const ComplexSelector& selector) {
+    uint32_t node = append(FK_COMPLEX_SELECTOR);
+    Siblings children { *this, node };
+
+    for (const auto& [combinator, compound] : selector) {
+        if (auto t = std::get_if<Token>(&combinator)) {
+            children.push(append(FK_COMBINATOR, t));
+        }
+        else if (auto pair = std::get_if<std::pair<Token, Token>>(&combinator)) {
+            children.push(append(FK_COMBINATOR, &pair->first));
+            tokens.push_back(pair->second);
+        }
+
+        children.push(add(compound));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const CompoundSelector& selector) {
+    uint32_t node = append(FK_COMPOUND_SELECTOR);
+    Siblings children { *this, node };
+
+    if (selector.typeSelector) {
+        children.push(add(*selector.typeSelector));
+    }
+
+    for (const SubclassSelector& subclass : selector.subclassSelectors) {
+        if (auto id = std::get_if<IdSelector>(&subclass)) {
+            children.push(append(FK_ID_SELECTOR, id));
+        }
+        else if (auto cls = std::get_if<ClassSelector>(&subclass)) {
+            children.push(append(FK_CLASS_SELECTOR, &cls->ident));
+        }
+        else if (auto attribute = std::get_if<AttributeSelector>(&subclass)) {
+            children.push(add(*attribute));
+        }
+        else if (auto pseudo = std::get_if<PseudoClassSelector>(&subclass)) {
+            children.push(add(*pseudo));
+        }
+    }
+
+    for (const auto& [element, classes] : selector.pseudoSelectors) {
+        children.push(add(element.selector, FK_PSEUDO_ELEMENT));
+
+        for (const PseudoClassSelector& pseudo : classes) {
+            children.push(add(pseudo));
+        }
+    }
+
+    return node;
+}
+
+void FlatTree::addNsPrefix(Siblings& siblings, const NsPrefix& prefix) {
+    if (prefix.value) {
+        siblings.push(add(*prefix.value));
+    }
+
+    siblings.push(add(prefix.bar));
+}
+
+void FlatTree::addWqName(Siblings& siblings, const WqName& name) {
+    if (name.prefix) {
+        addNsPrefix(siblings, *name.prefix);
+    }
+
+    siblings.push(add(name.ident));
+}
+
+uint32_t FlatTree::add(const TypeSelector& selector) {
+    uint32_t node = append(FK_TYPE_SELECTOR);
+    Siblings children { *this, node };
+
+    if (selector.wqName) {
+        addWqName(children, *selector.wqName);
+    }
+    else {
+        if (selector.nsPrefix) {
+            addNsPrefix(children, *selector.nsPrefix);
+        }
+
+        if (selector.star) {
+            children.push(add(*selector.star));
+        }
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const AttributeSelector& selector) {
+    uint32_t node = append(FK_ATTRIBUTE_SELECTOR);
+    Siblings children { *this, node };
+    addWqName(children, selector.name);
+
+    if (selector.matcher) {
+        if (selector.matcher->tok) {
+            children.push(add(*selector.matcher->tok));
+        }
+
+        children.push(add(selector.matcher->eq));
+    }
+
+    if (selector.tok) {
+        children.push(add(*selector.tok));
+    }
+
+    if (selector.modifier) {
+        children.push(add(*selector.modifier));
+    }
+
+    return node;
+}
+
+uint32_t FlatTree::add(const PseudoClassSelector& selector, FlatKind kind) {
+    uint32_t node = append(kind, &selector.tok);
+    Siblings children { *this, node };
+
+    if (selector.anyValue) {
+        for (const ComponentValue& value : *selector.anyValue) {
+            children.push(add(value));
+        }
+    }
+
+    return node;
+}
@@ -4,75 +4,147 @@
 // TODO Improve error messages. Many errors are ambiguous.
 
 #include <hcss/parser/parser.hpp>
+#include <hcss/parser/clone.hpp>
 #include <hcss/parser/componentValueParser.hpp>
 #include <hcss/parser/grammar/selector.hpp>
 #include <hcss/parser/selectorParser.hpp>
 #include <hcss/parser/styleBlockParser.hpp>
 #include <hcss/parser/types.hpp>
 
+#include <exception>
+#include <future>
 #include <iostream>
 #include <iterator>
+#include <mutex>
 #include <variant>
 #include <queue>
+#include <stdexcept>
 #include <algorithm>
 
+// Fewest top-level rules worth handing to a thread pool, and how many a thread claims at a time
+constexpr size_t PARALLEL_RULES = 256;
+constexpr size_t PARALLEL_BATCH = 16;
+
 #pragma region Scope
 
+/**
+ * @param values The parsed value. Its flags are worked out here, once per definition.
+ */
+
+Variable::Variable(NodeList<ComponentValue> values)
+    : values(std::move(values)), nodes(countNodes(this->values))
+{
+    for (const ComponentValue& value : this->values) {
+        if (auto t = std::get_if<Token>(&value)) {
+            switch (t->type) {
+                case COMMA: commas = true; break;
+                case DELIM: flat = flat && t->lexeme[0] != '$'; break;
+                case T_EOF: case SEMICOLON:
+                case LEFT_PAREN: case RIGHT_PAREN:
+                case LEFT_BRACKET: case RIGHT_BRACKET:
+                case LEFT_BRACE: case RIGHT_BRACE: flat = false; break;
+                default: break;
+            }
+        }
+        else if (auto block = std::get_if<SimpleBlock>(&value)) {
+            flat = flat && !block->unwalked && block->open.type != LEFT_BRACE;
+        }
+        else if (auto call = std::get_if<FunctionCall>(&value)) {
+            flat = flat && !call->unwalked;
+        }
+    }
+}
+
+/**
+ * @brief Enters a block. Definitions made until the matching pop() belong to it.
+ */
+
+void Scope::push() {
+    depth++;
+}
+
+/**
+ * @brief Leaves a block, dropping the definitions it made
+ */
+
+void Scope::pop() {
+    variables.drop(depth);
+    atRules.drop(depth);
+    mixins.drop(depth);
+    parameters.drop(depth);
+    depth--;
+}
+
+void Scope::defineVariable(Atom name, NodeList<ComponentValue> value) {
+    variables.define(name, depth, Variable(std::move(value)));
+}
+
+void Scope::defineAtRule(Atom name, NodeList<ComponentValue> value) {
+    atRules.define(name, depth, Variable(std::move(value)));
+}
+
+void Scope::defineMixin(Atom name, Mixin mixin) {
+    mixins.define(name, depth, std::move(mixin));
+}
+
+/**
+ * @brief Adds a parameter of the mixin being defined. Parameters stay until clearParameters() at the same depth.
+ */
+
+void Scope::addParameter(Atom name) {
+    parameters.define(name, depth, {});
+}
+
+void Scope::clearParameters() {
+    parameters.drop(depth);
+}
+
 /**
  * @brief Finds a previously defined at-rule. Checks parent scopes recursively.
  *
  * @param name The name of the at-rule
- * @return vector<ComponentValue>* Returns a pointer to the at-rule if successful.
+ * @return Variable* Returns a pointer to the at-rule if successful.
  * @return nullptr Otherwise returns null pointer.
  */
 
-vector<ComponentValue>* Scope::findAtRule(const wstring& name) {
-    if (atRules.contains(name)) {
-        return &atRules[name];
-    }
-    else if (parent) {
-        return parent->findAtRule(name);
+Variable* Scope::findAtRule(Atom name) {
+    if (auto value = atRules.find(name)) {
+        return value;
     }
 
-    return nullptr;
+    return parent ? parent->findAtRule(name) : nullptr;
 }
 
 /**
  * @brief Finds a previously defined mixin. Checks parent scopes recursively.
  *
  * @param name The name of the mixin
- * @return vector<ComponentValue>* Returns a pointer to the mixin if successful.
+ * @return Mixin* Returns a pointer to the mixin if successful.
  * @return nullptr Otherwise returns null pointer.
  */
 
-Mixin* Scope::findMixin(const wstring& name) {
-    if (mixins.contains(name)) {
-        return &mixins[name];
-    }
-    else if (parent) {
-        return parent->findMixin(name);
+Mixin* Scope::findMixin(Atom name) {
+    if (auto mixin = mixins.find(name)) {
+        return mixin;
     }
 
-    return nullptr;
+    return parent ? parent->findMixin(name) : nullptr;
 }
 
 /**
  * @brief Finds a previously defined variable. Checks parent scopes recursively.
  *
  * @param name The name of the variable
- * @return vector<ComponentValue>* Returns a pointer to the variable if successful.
+ * @return Variable* Returns a pointer to the variable if successful.
  * @return nullptr Otherwise returns null pointer.
  */
 
-vector<ComponentValue>* Scope::findVariable(const wstring& name) {
-    if (variables.contains(name)) {
-        return &variables[name];
-    }
-    else if (parent) {
-        return parent->findVariable(name);
+Variable* Scope::findVariable(Atom name) {
+    if (auto value = variables.find(name)) {
+        return value;
     }
 
-    return nullptr;
+    return parent ? parent->findVariable(name) : nullptr;
 }
 
 /**
@@ -81,99 +153,482 @@ vector<ComponentValue>* Scope::findVariable(const wstring& name) {
  * @param name The name of the variable
  */
 
-bool Scope::isParameter(const wstring& name) {
-    if (std::count(parameters.begin(), parameters.end(), name)) {
-        return true;
+bool Scope::isParameter(Atom name) {
+    return parameters.find(name) || (parent && parent->isParameter(name));
+}
+
+/**
+ * @brief Copies the definitions made in this scope, for another thread to look up names in while this one is used too.
+ * @brief Mixins keep their parsed body but not their instances or counts. 'parent' is shared, not copied.
+ */
+
+Scope Scope::snapshot() {
+    Scope copy;
+    copy.parent = parent;
+    copy.depth = depth;
+
+    for (const auto& binding : variables) {
+        copy.variables.define(binding.name, binding.depth, Variable(clone(binding.value.values)));
     }
-    else if (parent) {
-        return parent->isParameter(name);
+
+    for (const auto& binding : atRules) {
+        copy.atRules.define(binding.name, binding.depth, Variable(clone(binding.value.values)));
     }
 
-    return false;
+    for (const auto& binding : mixins) {
+        const Mixin& mixin = binding.value;
+        Mixin mixinCopy { mixin.function ? optional(clone(*mixin.function)) : nullopt, clone(mixin.value) };
+
+        if (mixin.body) {
+            mixinCopy.body = clone(*mixin.body);
+        }
+
+        mixinCopy.compiled = mixin.compiled;
+        copy.mixins.define(binding.name, binding.depth, std::move(mixinCopy));
+    }
+
+    for (const auto& binding : parameters) {
+        copy.parameters.define(binding.name, binding.depth, {});
+    }
+
+    return copy;
+}
+
+#pragma endregion
+
+#pragma region Budget
+
+ExpansionBudget::ExpansionBudget(const ExpansionLimits& limits)
+    : limits(limits), deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.milliseconds))
+{}
+
+/**
+ * @brief Counts 'count' values copied in by an expansion
+ *
+ * @param at Where the expansion was, for the error
+ * @return Throws ExpansionError once the cap is passed
+ */
+
+void ExpansionBudget::spend(size_t count, const Token* at) {
+    uint64_t total = tokens += count;
+
+    if (limits.tokens && total > limits.tokens) {
+        EXPANSION_ERROR("Expanding variables and mixins made more than " + to_string(limits.tokens) + " values", at);
+    }
+
+    tick(at);
+}
+
+/**
+ * @brief Counts 'count' style block items added to a block
+ *
+ * @return Throws ExpansionError once the cap is passed
+ */
+
+void ExpansionBudget::build(size_t count, const Token* at) {
+    uint64_t total = nodes += count;
+
+    if (limits.nodes && total > limits.nodes) {
+        EXPANSION_ERROR("The style sheet has more than " + to_string(limits.nodes) + " style block items", at);
+    }
+
+    tick(at);
+}
+
+/**
+ * @brief Checks the deadline. The clock is only read every so often, since this runs for every item.
+ */
+
+void ExpansionBudget::tick(const Token* at) {
+    if (!limits.milliseconds || ++ticks < 64) {
+        return;
+    }
+
+    ticks = 0;
+
+    if (std::chrono::steady_clock::now() > deadline) {
+        EXPANSION_ERROR("Parsing took longer than " + to_string(limits.milliseconds) + " ms", at);
+    }
 }
 
 #pragma endregion
 
 #pragma region Parser
 
+/**
+ * @brief The budget of the compilation, started from 'limits' if no other parser handed one in. parse() starts it
+ * @brief first thing, so its deadline counts from the start of the parse and worker threads never race to start it.
+ */
+
+ExpansionBudget& Parser::budget() {
+    if (!shared) {
+        shared = &own.emplace(limits);
+    }
+
+    return *shared;
+}
+
+/**
+ * @brief Sets up a parser started for a block or mixin body, so it draws from this parser's budget and sees the
+ * @brief mixins being included around it
+ *
+ * @param start The position() where the rule or @include that started it began
+ * @param mixin The name of the mixin whose body 'child' parses, nullptr for a block
+ */
+
+void Parser::enter(Parser& child, int64_t start, const Token* mixin) {
+    child.shared = &budget();
+    child.caller = this;
+    child.callStart = start;
+
+    if (mixin) {
+        expand(*mixin, start);
+        child.regions.push_back({ mixin->atom(), INT64_MAX, false });
+    }
+}
+
+/**
+ * @brief Checks that a mixin can be included by an @include that began at 'start': it must not be in the middle of
+ * @brief being included already, and there must be room for one more level. Walks the regions of this parser and
+ * @brief then of the parsers that started it, so a check is as long as the nesting and not the input.
+ *
+ * @param name The name of the mixin in the @include
+ * @return Throws ExpansionError on a cycle or when the nesting is too deep
+ */
+
+void Parser::expand(const Token& name, int64_t start) {
+    Atom mixin = name.atom();
+
+    while (!regions.empty() && regions.back().end <= start) {
+        regions.pop_back();
+    }
+
+    string chain(atomName(mixin));
+    uint32_t depth = 0;
+
+    for (Parser* parser = this; parser; start = parser->callStart, parser = parser->caller) {
+        bool skip = false;
+
+        for (auto it = parser->regions.rbegin(); it != parser->regions.rend(); it++) {
+            if (start >= it->end) {
+                continue;
+            }
+
+            // A later sibling of a region the @include is in
+            if (skip) {
+                skip = it->before;
+                continue;
+            }
+
+            skip = it->before;
+            depth++;
+            chain = string(atomName(it->mixin)) + " -> " + chain;
+
+            if (it->mixin == mixin) {
+                EXPANSION_ERROR("The mixin '" + string(atomName(mixin)) + "' includes itself: " + chain, name);
+            }
+        }
+    }
+
+    uint32_t limit = budget().limits.depth;
+
+    if (limit && depth >= limit) {
+        EXPANSION_ERROR("Mixins are included more than " + to_string(limit) + " deep: " + chain, name);
+    }
+}
+
+/**
+ * @brief Checks if the next value is a SimpleBlock or FunctionCall from BlockBuilder that still has to be walked
+ */
+
+bool Parser::checkUnwalked() {
+    if (!more()) return false;
+
+    if (auto block = std::get_if<SimpleBlock>(&front())) {
+        return block->unwalked;
+    }
+    else if (auto call = std::get_if<FunctionCall>(&front())) {
+        return call->unwalked;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Puts the tokens of an unwalked SimpleBlock back in front of the cursor, so its contents are walked
+ * (variables, scopes, etc.) the same way as a flat token list. Nested nodes stay as they are until they are reached.
+ *
+ * @param block The block to unwrap
+ */
+
+void Parser::unwrap(SimpleBlock&& block) {
+    if (block.close) {
+        prepend(std::move(*block.close));
+    }
+
+    prepend(std::make_move_iterator(block.value.begin()), std::make_move_iterator(block.value.end()));
+    prepend(std::move(block.open));
+}
+
+/**
+ * @brief Puts the tokens of an unwalked FunctionCall back in front of the cursor, with commas between the arguments
+ *
+ * @param call The function call to unwrap
+ */
+
+void Parser::unwrap(FunctionCall&& call) {
+    prepend(Token(RIGHT_PAREN, ")"));
+
+    for (auto it = call.arguments.rbegin(); it != call.arguments.rend(); it++) {
+        prepend(std::make_move_iterator(it->begin()), std::make_move_iterator(it->end()));
+
+        if (it + 1 != call.arguments.rend()) {
+            prepend(Token(COMMA, ","));
+        }
+    }
+
+    prepend(std::move(call.name));
+}
+
 /**
  * @brief Parses a style sheet
  *
- * @return vector<SyntaxNode> A list of parsed SyntaxNodes
+ * @return NodeList<SyntaxNode> A list of parsed SyntaxNodes
+ * @return Throws std::invalid_argument if the sheet is large enough to resolve on 'pool' and an Arena is current but
+ * 'arenas' is not set. Smaller sheets are resolved on this thread either way.
  */
 
-vector<SyntaxNode> Parser::parse() {
+NodeList<SyntaxNode> Parser::parse() {
+    // Started before any work, so the deadline counts from here
+    budget();
     rules = consumeRulesList();
     top = false;
-    for (auto & i : rules) {
-        if (auto rule = std::get_if<QualifiedRule>(&i)) {
-            ComplexSelectorList selectors = SelectorParser(rule->prelude).parse();
-        
-            // TEST Needs to be changed to accept more than one selector as long as all of them are events
-            if (selectors.size() == 1 && selectors.front().size() == 1) {
-                CompoundSelector sel = selectors.front().front().second;
-
-                if (!sel.subclassSelectors.empty()) {
-                    if (auto pseudo = std::get_if<PseudoClassSelector>(&sel.subclassSelectors.back())) {
-                        if (wstrcompi(pseudo->tok.lexeme, L"click")) {
-                            continue;
-                        }
+
+    if (pool && rules.size() >= PARALLEL_RULES) {
+        if (Arena::current() && !arenas) {
+            throw std::invalid_argument("Parser::pool needs Parser::arenas while an Arena is current");
+        }
+
+        resolveParallel();
+    }
+    else {
+        for (auto & i : rules) {
+            resolve(i, scope);
+        }
+    }
+
+    return std::move(rules);
+}
+
+/**
+ * @brief Resolves the top-level rules on 'pool' and this thread. Once the rules list is read, resolving only looks up
+ * @brief names, so each thread takes a snapshot of the scope and then claims batches of rules off a shared counter until
+ * @brief none are left. Every rule ends up in its own slot, so the list keeps its order. While an Arena is current, each
+ * @brief thread works in one of 'arenas' instead and resolves a copy of each rule, since the rules' lists would otherwise
+ * @brief grow and free into the current arena from several threads. The copies are moved in once every thread is done.
+ *
+ * @return Rethrows the error of the first rule in source order that failed, the same one a serial parse throws
+ */
+
+void Parser::resolveParallel() {
+    std::atomic<size_t> next = 0;
+    // Index of the first rule that failed, rules.size() while none has
+    std::atomic<size_t> failedAt = rules.size();
+    std::exception_ptr failure;
+    std::mutex lock;
+    size_t jobs = std::min<size_t>(pool->size(), rules.size() / PARALLEL_BATCH);
+    bool copying = Arena::current();
+    // The rules resolved in the threads' arenas, by index
+    std::vector<optional<SyntaxNode>> copies(copying ? rules.size() : 0);
+    std::atomic<size_t> started = 0;
+
+    while (copying && arenas->size() < jobs) {
+        arenas->emplace_back();
+    }
+
+    auto work = [&] {
+        optional<ArenaScope> own;
+
+        if (copying) {
+            own.emplace((*arenas)[started++]);
+        }
+
+        Scope visible = scope.snapshot();
+
+        for (size_t first; (first = next.fetch_add(PARALLEL_BATCH)) < failedAt;) {
+            size_t last = std::min(first + PARALLEL_BATCH, rules.size());
+
+            for (size_t i = first; i < last && i < failedAt; i++) {
+                try {
+                    if (!copying) {
+                        resolve(rules[i], visible);
+                    }
+                    else if (std::holds_alternative<QualifiedRule>(rules[i])) {
+                        resolve(copies[i].emplace(clone(rules[i])), visible);
+                    }
+                }
+                catch (...) {
+                    std::lock_guard guard(lock);
+
+                    if (i < failedAt) {
+                        failedAt = i;
+                        failure = std::current_exception();
                     }
                 }
             }
+        }
 
-            // Parse style block
-            if (rule->block) {
-                StyleBlockParser parser(rule->block->value);
-                parser.scope.parent = &scope;
+        std::lock_guard guard(lock);
 
-                i = StyleRule(selectors, parser.parse());
-            }
-            else {
-                i = StyleRule(selectors);
-            }
+        for (const auto& binding : visible.mixins) {
+            resolved.hits += binding.value.stats.hits;
+            resolved.misses += binding.value.stats.misses;
+        }
+    };
+
+    std::vector<std::future<void>> helpers;
+
+    for (size_t i = 1; i < jobs; i++) {
+        helpers.push_back(pool->submit(work));
+    }
+
+    work();
+
+    for (auto& helper : helpers) {
+        helper.get();
+    }
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    for (size_t i = 0; i < copies.size(); i++) {
+        if (copies[i]) {
+            rules[i] = std::move(*copies[i]);
         }
     }
-    return rules;
 }
 
 /**
- * @brief Consumes a list of rules
+ * @brief Totals the instance cache counters of the mixins in scope and of the snapshots parse() resolved rules with. A
+ * mixin that was redefined, or dropped with the block it was defined in, takes its counts with it.
+ */
+
+IncludeStats Parser::includeStats() {
+    IncludeStats total = resolved;
+
+    for (const auto& binding : scope.mixins) {
+        total.hits += binding.value.stats.hits;
+        total.misses += binding.value.stats.misses;
+    }
+
+    return total;
+}
+
+/**
+ * @brief Turns a top-level QualifiedRule into a StyleRule by parsing its selectors and style block. Other rules and
+ * event rules (:click) are left as they are.
  *
- * @return vector<SyntaxNode> Rules list
+ * @param node The rule to resolve, replaced in place
+ * @param visible The scope the style block sees, 'scope' or a snapshot of it
  */
 
-vector<SyntaxNode> Parser::consumeRulesList() {
-    vector<SyntaxNode> list;
+void Parser::resolve(SyntaxNode& node, Scope& visible) {
+    auto rule = std::get_if<QualifiedRule>(&node);
 
-    while (auto t = peek<Token>()) {
-        switch (t->type) {
-            case T_EOF: return list;
-            case CDO: case CDC: {
-                if (!top) {
-                    list.emplace_back(consumeQualifiedRule());
+    if (!rule) {
+        return;
+    }
+
+    // Event rules are left as they are, so the selector parser gets a copy of the prelude
+    ComplexSelectorList selectors = SelectorParser(clone(rule->prelude)).parse();
+
+    // TEST Needs to be changed to accept more than one selector as long as all of them are events
+    if (selectors.size() == 1 && selectors.front().size() == 1) {
+        const CompoundSelector& sel = selectors.front().front().second;
+
+        if (!sel.subclassSelectors.empty()) {
+            if (auto pseudo = std::get_if<PseudoClassSelector>(&sel.subclassSelectors.back())) {
+                if (pseudo->tok.keyword == KW_CLICK) {
+                    return;
                 }
-                break;
             }
-            case AT_KEYWORD: {
-                if (auto rule = consumeAtRule()) {
-                    list.emplace_back(*rule);
-                }
-                break;
+        }
+    }
+
+    // Parse style block
+    if (rule->block) {
+        StyleBlockParser parser(std::move(rule->block->value));
+        parser.scope.parent = &visible;
+        enter(parser, position());
+
+        node = StyleRule(std::move(selectors), parser.parse());
+    }
+    else {
+        node = StyleRule(std::move(selectors));
+    }
+}
+
+/**
+ * @brief Consumes a list of rules
+ *
+ * @return NodeList<SyntaxNode> Rules list
+ */
+
+NodeList<SyntaxNode> Parser::consumeRulesList() {
+    NodeList<SyntaxNode> list;
+
+    while (consumeRule(list));
+
+    return list;
+}
+
+/**
+ * @brief Consumes the next item of a rules list. Rules are appended to 'list', definitions only go into the scope.
+ *
+ * @param list The list to append the rule to
+ * @return false At the end of the list
+ */
+
+bool Parser::consumeRule(NodeList<SyntaxNode>& list) {
+    if (!more()) {
+        return false;
+    }
+
+    auto t = peek<Token>();
+
+    if (!t) {
+        list.emplace_back(consumeQualifiedRule());
+        return true;
+    }
+
+    switch (t->type) {
+        case T_EOF: return false;
+        case CDO: case CDC: {
+            if (!top) {
+                list.emplace_back(consumeQualifiedRule());
             }
-            case DELIM: {
-                if (t->lexeme[0] == '$') {
-                    consumeVariable();
-                    break;
-                }
+            break;
+        }
+        case AT_KEYWORD: {
+            if (auto rule = consumeAtRule()) {
+                list.emplace_back(std::move(*rule));
             }
-            default: {
-                list.emplace_back(consumeQualifiedRule());
+            break;
+        }
+        case DELIM: {
+            if (t->lexeme[0] == '$') {
+                consumeVariable();
                 break;
             }
         }
+        default: {
+            list.emplace_back(consumeQualifiedRule());
+            break;
+        }
     }
-    return list;
+
+    return true;
 }
 
 /**
@@ -205,27 +660,16 @@ ComponentValue Parser::consumeComponentValue() {
             }
             default: {
                 auto temp = std::move(*t);
-                values.pop_front();
+                skip();
 
                 return temp;
             }
         }
     }
-    return consume();
-}
-
-/**
- * @brief Consumes a component value, and if the value is not monostate, pushes it to 'vec'
- *
- * @param vec The vector to push the consumed value to
- */
-
-void Parser::consumeComponentValue(vector<ComponentValue>& vec) {
-    auto v = consumeComponentValue();
-
-    if (v.index()) {
-        vec.emplace_back(v);
+    else if (checkUnwalked()) {
+        return check<SimpleBlock>() ? ComponentValue(consumeSimpleBlock()) : ComponentValue(consumeFunctionCall());
     }
+    return consume();
 }
 
 /**
@@ -237,87 +681,135 @@ void Parser::consumeComponentValue(vector<ComponentValue>& vec) {
 optional<AtRule> Parser::consumeAtRule() {
     Token at = consume(AT_KEYWORD, "Expected AT_KEYWORD");
 
-    if (wstrcompi(at.lexeme, L"mixin")) {
-        consumeMixin();
-    }
-    else if (check('=') && !wstrcompi(at.lexeme, L"media")) {
-        values.pop_front();
-        scope.atRules[at.lexeme] = consumeValueList();
-    }
-    else if (auto atRule = scope.findAtRule(at.lexeme)) {
-        values.insert(values.begin(), atRule->begin(), atRule->end());
-        values.push_front(Token(AT_KEYWORD, L"media"));
-    }
-    else {
-        AtRule rule(at);
-
-        while (!values.empty()) {
-            if (auto t = peek<Token>()) {
-                switch (t->type) {
-                    case T_EOF: case SEMICOLON: values.pop_front(); return rule;
-                    case LEFT_BRACE: {
-                        rule.block = consumeSimpleBlock();
-                        return rule;
-                    }
-                    default: {
-                        consumeComponentValue(rule.prelude);
-                    }
+    NodeList<ComponentValue> prelude;
+
+    switch (at.keyword) {
+        case KW_MIXIN: {
+            consumeMixin();
+            return nullopt;
+        }
+        case KW_MEDIA: break;
+        default: {
+            if (check('=')) {
+                skip();
+                NodeList<ComponentValue> value = consumeValueList();
+
+                if (store) {
+                    store->keep(value);
                 }
+
+                scope.defineAtRule(at.atom(), std::move(value));
+                return nullopt;
             }
-            else {
-                auto block = peek<SimpleBlock>();
+            else if (auto alias = scope.findAtRule(at.atom())) {
+                spend(alias->nodes, &at);
+
+                if (alias->flat) {
+                    // The alias's query starts the prelude of a media rule, the same as parsing it again would
+                    at = Token(AT_KEYWORD, "media");
+                    prelude = clone(alias->values);
+                    break;
+                }
+
+                NodeList<ComponentValue> copy = clone(alias->values);
+                prepend(std::make_move_iterator(copy.begin()), std::make_move_iterator(copy.end()));
+                prepend(Token(AT_KEYWORD, "media"));
+                return nullopt;
+            }
+        }
+    }
 
-                if (block && block->open.type == LEFT_BRACE) {
-                    rule.block = std::move(*block);
-                    values.pop_front();
+    AtRule rule(at, std::move(prelude));
 
+    while (more()) {
+        if (auto t = peek<Token>()) {
+            switch (t->type) {
+                case T_EOF: case SEMICOLON: skip(); return rule;
+                case LEFT_BRACE: {
+                    rule.block = consumeSimpleBlock();
                     return rule;
                 }
-                else {
+                default: {
                     consumeComponentValue(rule.prelude);
                 }
             }
         }
+        else {
+            auto block = std::get_if<SimpleBlock>(&front());
 
-        return rule;
+            if (block && block->open.type == LEFT_BRACE) {
+                rule.block = consumeSimpleBlock();
+                return rule;
+            }
+            else {
+                consumeComponentValue(rule.prelude);
+            }
+        }
     }
 
-    return nullopt;
+    return rule;
 }
 
 void Parser::consumeMixin() {
-    wstring lexeme;
+    Atom name = ATOM_NONE;
     optional<FunctionDefinition> func;
 
     if (check(IDENT)) {
-        lexeme = consume(IDENT, "Expected identifier").lexeme;
+        name = consume(IDENT, "Expected identifier").atom();
     }
-    else if (check(FUNCTION)) {
+    else if (check(FUNCTION) || check<FunctionCall>()) {
         func = consumeFunctionDefinition();
-        lexeme = func->name.lexeme;
+        name = func->name.atom();
     }
-    if (!check(LEFT_BRACE)) {
+    if (!check(LEFT_BRACE) && !check<SimpleBlock>()) {
         SYNTAX_ERROR("Expected opening brace", nullopt);
     }
 
-    scope.mixins[lexeme] = { func, consumeSimpleBlock().value };
-    scope.parameters.clear();
+    Mixin mixin { std::move(func), std::move(consumeSimpleBlock().value) };
+
+    if (store) {
+        store->keep(mixin.value);
+
+        if (mixin.function) {
+            store->keep(mixin.function->name);
+
+            for (auto& [parameter, fallback] : mixin.function->parameters) {
+                store->keep(fallback);
+            }
+        }
+
+        mixin.store = store;
+    }
+
+    scope.defineMixin(name, std::move(mixin));
+    scope.clearParameters();
 }
 
-vector<vector<ComponentValue>> Parser::consumeCommaList() {
-    vector<vector<ComponentValue>> value = {};
+ArgumentList Parser::consumeCommaList() {
+    ArgumentList value = {};
     int parens = 0;
 
-    while (auto t = peek<Token>()) {
+    while (more()) {
+        auto t = peek<Token>();
+
+        if (!t) {
+            if (!value.size()) {
+                value.emplace_back();
+            }
+
+            consumeComponentValue(value.back(), true);
+            continue;
+        }
+
         switch (t->type) {
-            case T_EOF: values.pop_front(); break;
+            case T_EOF: skip(); break;
             case LEFT_PAREN: {
                 if (!value.size()) {
                     value.emplace_back();
                 }
 
                 value.back().push_back(std::move(*t));
-                values.pop_front();
+                skip();
                 parens++;
                 break;
             }
@@ -325,11 +817,11 @@ vector<vector<ComponentValue>> Parser::consumeCommaList() {
                 if (parens > 0) {
                     parens--;
                     value.back().push_back(std::move(*t));
-                    values.pop_front();
+                    skip();
                     break;
                 }
                 else {
-                    values.pop_front();
+                    skip();
                     return value;
                 }
             }
@@ -341,7 +833,7 @@ vector<vector<ComponentValue>> Parser::consumeCommaList() {
                     value.back().push_back(std::move(*t));
                 }
 
-                values.pop_front();
+                skip();
                 break;
             }
             default: {
@@ -349,7 +841,7 @@ vector<vector<ComponentValue>> Parser::consumeCommaList() {
                     value.emplace_back();
                 }
 
-                consumeComponentValue(value.back());
+                consumeComponentValue(value.back(), true);
             }
         }
     }
@@ -357,42 +849,46 @@ vector<vector<ComponentValue>> Parser::consumeCommaList() {
 }
 
 FunctionDefinition Parser::consumeFunctionDefinition() {
+    if (check<FunctionCall>()) {
+        unwrap(consume<FunctionCall>());
+    }
+
     FunctionDefinition f(consume(FUNCTION, "Expected function"));
     bool optional = false;
 
     while (auto t = peek<Token>()) {
         switch (t->type) {
             case RIGHT_PAREN: {
-                values.pop_front();
+                skip();
                 return f;
             }
             case COMMA: {
-                values.pop_front();
+                skip();
             }
             case DELIM: {
                 auto dollar = consume(DELIM, "Expected $");
 
-                if (dollar.lexeme[0] != L'$') {
+                if (dollar.lexeme[0] != '$') {
                     SYNTAX_ERROR("Expected $", dollar);
                 }
 
                 Token name = consume(IDENT, "Expected identifier");
-                scope.parameters.push_back(name.lexeme);
-                vector<ComponentValue> _default;
+                scope.addParameter(name.atom());
+                NodeList<ComponentValue> _default;
 
                 if (check(COLON)) {
                     optional = true;
-                    values.pop_front();
+                    skip();
 
-                    while (!values.empty() && !check(COMMA) && !check(RIGHT_PAREN)) {
-                        consumeComponentValue(_default);
+                    while (more() && !check(COMMA) && !check(RIGHT_PAREN)) {
+                        consumeComponentValue(_default, true);
                     }
                 }
                 else if (optional) {
                     SYNTAX_ERROR("Optional parameters must come last", name);
                 }
 
-                f.parameters.emplace_back(name.lexeme, std::move(_default));
+                f.parameters.emplace_back(name.atom(), std::move(_default));
                 break;
             }
             default: {
@@ -404,13 +900,21 @@ FunctionDefinition Parser::consumeFunctionDefinition() {
 }
 
 FunctionCall Parser::consumeFunctionCall() {
+    if (check<FunctionCall>()) {
+        if (!checkUnwalked()) {
+            return consume<FunctionCall>();
+        }
+
+        unwrap(consume<FunctionCall>());
+    }
+
     return { consume(FUNCTION, "Expected function"), consumeCommaList() };
 }
 
 QualifiedRule Parser::consumeQualifiedRule() {
     QualifiedRule rule;
 
-    while (!values.empty()) {
+    while (more()) {
         if (auto t = peek<Token>()) {
             switch (t->type) {
                 case T_EOF: SYNTAX_ERROR("Qualified rule was not closed. Reached end of file.", nullopt);
@@ -424,11 +928,10 @@ QualifiedRule Parser::consumeQualifiedRule() {
             }
         }
         else {
-            auto block = peek<SimpleBlock>();
+            auto block = std::get_if<SimpleBlock>(&front());
 
             if (block && block->open.type == LEFT_BRACE) {
-                rule.block = *block;
-                values.pop_front();
+                rule.block = consumeSimpleBlock();
                 return rule;
             }
 
@@ -439,16 +942,23 @@ QualifiedRule Parser::consumeQualifiedRule() {
 }
 
 SimpleBlock Parser::consumeSimpleBlock() {
-    Scope _scope(scope);
-    scope = { &_scope };
+    if (check<SimpleBlock>()) {
+        if (!checkUnwalked()) {
+            return consume<SimpleBlock>();
+        }
+
+        unwrap(consume<SimpleBlock>());
+    }
+
+    scope.push();
     SimpleBlock block(consume<Token>());
     TokenType close = mirror(block.open.type);
 
-    while (!values.empty()) {
+    while (more()) {
         if (auto t = peek<Token>()) {
             if (t->type == close) {
                 block.close = std::move(*t);
-                values.pop_front();
+                skip();
                 break;
             }
             else if (t->type == T_EOF) {
@@ -459,23 +969,23 @@ SimpleBlock Parser::consumeSimpleBlock() {
         consumeComponentValue(block.value);
     }
 
-    scope = *scope.parent;
+    scope.pop();
     return block;
 }
 
 /**
  * @brief Consumes a value list for things like variables and custom media queries
  *
- * @return vector<ComponentValue> The list of consumed values
+ * @return NodeList<ComponentValue> The list of consumed values
  */
 
-vector<ComponentValue> Parser::consumeValueList() {
-    vector<ComponentValue> val;
+NodeList<ComponentValue> Parser::consumeValueList() {
+    NodeList<ComponentValue> val;
 
-    while (!values.empty()) {
+    while (more()) {
         if (auto t = peek<Token>()) {
             if (t->type == SEMICOLON) {
-                values.pop_front();
+                skip();
                 break;
             }
         }
@@ -488,31 +998,72 @@ vector<ComponentValue> Parser::consumeValueList() {
 
 /**
  * @brief If it is an assignment, it consumes the name and value and adds it to the variables map
- * @brief Otherwise, it pushes the variable's value to the front of the deque
+ * @brief Otherwise, it puts the variable's value in front of the cursor
  *
  * @return Returns whether a variable was consumed or not. Variables are usually only not consumed if it is a parameter.
  */
 
 bool Parser::consumeVariable() {
-    values.pop_front();
+    skip();
     Token name = consume(IDENT, "Expected identifier");
 
     if (check(COLON)) {
-        values.pop_front();
-        scope.variables[name.lexeme] = consumeValueList();
+        skip();
+        NodeList<ComponentValue> value = consumeValueList();
+
+        if (store) {
+            store->keep(value);
+        }
+
+        scope.defineVariable(name.atom(), std::move(value));
     }
-    else if (scope.isParameter(name.lexeme)) {
-        values.push_front(name);
+    else if (scope.isParameter(name.atom())) {
+        parameterReferences++;
+        prepend(std::move(name));
         return false;
     }
-    else if (auto var = scope.findVariable(name.lexeme)) {
-        values.insert(values.begin(), var->begin(), var->end());
+    else if (auto var = scope.findVariable(name.atom())) {
+        spend(var->nodes, &name);
+        NodeList<ComponentValue> copy = clone(var->values);
+        prepend(std::make_move_iterator(copy.begin()), std::make_move_iterator(copy.end()));
     }
     else {
-        SYNTAX_ERROR("The variable '" + string(name.lexeme.begin(), name.lexeme.end()) + "' was not declared.", name);
+        SYNTAX_ERROR("The variable '" + string(name.lexeme) + "' was not declared.", name);
     }
 
     return true;
 }
 
+/**
+ * @brief Consumes a variable reference whose value can go straight into a list. Assignments, parameters, undeclared
+ * @brief names and values that are not flat are left at the cursor for consumeVariable.
+ *
+ * @param arguments Whether the list is a function argument. Values with a top-level comma are left then too.
+ * @return const Variable* The referenced variable, nullptr if nothing was consumed
+ */
+
+const Variable* Parser::consumeReference(bool arguments) {
+    auto t = peek<Token>();
+
+    if (!t || t->type != DELIM || t->lexeme[0] != '$' || !check(IDENT, 1) || check(COLON, 2)) {
+        return nullptr;
+    }
+
+    Atom name = peek<Token>(1)->atom();
+
+    if (scope.isParameter(name)) {
+        return nullptr;
+    }
+
+    const Variable* variable = scope.findVariable(name);
+
+    if (!variable || !variable->flat || (arguments && variable->commas)) {
+        return nullptr;
+    }
+
+    skip();
+    skip();
+    return variable;
+}
+
 #pragma endregion
\ No newline at end of file
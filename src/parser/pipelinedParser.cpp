@@ -0,0 +1,107 @@
+#include <hcss/parser/pipelinedParser.hpp>
+#include <exception>
+#include <iterator>
+#include <thread>
+
+// Top-level values per batch. Large enough that the queue is touched a few hundred times for a big sheet.
+constexpr size_t BATCH_SIZE = 1024;
+
+namespace {
+    // Thrown out of the lexer when the parser has stopped taking batches
+    struct Cancelled {};
+
+    // Publishes the builder's top-level values whenever a batch is full, and the rest at T_EOF. Top-level values are
+    // complete nodes, so a batch never holds half a block.
+    class Batcher : public BlockBuilder {
+        public:
+            explicit Batcher(SpscQueue<NodeList<ComponentValue>>& queue)
+                : queue(queue)
+            {};
+            void push(Token&& t) override {
+                bool eof = t.type == T_EOF;
+                BlockBuilder::push(std::move(t));
+
+                if (eof || values.size() >= BATCH_SIZE) {
+                    if (!queue.push(std::move(values))) {
+                        throw Cancelled();
+                    }
+
+                    values.clear();
+                }
+            }
+        private:
+            SpscQueue<NodeList<ComponentValue>>& queue;
+    };
+}
+
+/**
+ * @brief Lexes on a second thread while parsing on this one
+ *
+ * @return NodeList<SyntaxNode> The parsed rules
+ * @return Rethrows the lexer's error if lexing failed, otherwise the parser's
+ */
+
+NodeList<SyntaxNode> PipelinedParser::parse() {
+    std::exception_ptr failure;
+
+    std::thread producer([this, &failure] {
+        Batcher batcher(queue);
+
+        try {
+            lexer.lex(batcher);
+        }
+        catch (const Cancelled&) {}
+        catch (...) {
+            failure = std::current_exception();
+        }
+
+        queue.close();
+    });
+
+    Parser parser(NodeList<ComponentValue> {});
+    parser.source = this;
+    parser.limits = limits;
+    NodeList<SyntaxNode> rules;
+    std::exception_ptr parseFailure;
+
+    try {
+        rules = parser.parse();
+    }
+    catch (...) {
+        parseFailure = std::current_exception();
+    }
+
+    queue.cancel();
+    producer.join();
+
+    // A parse error after a lexer error is only about the input being cut short
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    else if (parseFailure) {
+        std::rethrow_exception(parseFailure);
+    }
+
+    return rules;
+}
+
+/**
+ * @brief Moves the next batch from the lexer thread into 'values'
+ */
+
+bool PipelinedParser::pull(NodeList<ComponentValue>& values) {
+    NodeList<ComponentValue> batch;
+
+    if (!queue.pop(batch)) {
+        return false;
+    }
+
+    if (values.empty()) {
+        values.swap(batch);
+    }
+    else {
+        values.insert(values.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+    }
+
+    return true;
+}
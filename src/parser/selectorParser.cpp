@@ -1,13 +1,14 @@
 #include <hcss/parser/selectorParser.hpp>
+#include <iterator>
 #include <queue>
 
 ComplexSelectorList SelectorParser::parse() {
     ComplexSelectorList list;
 
-    while (!values.empty()) {
+    while (more()) {
         list.emplace_back(consumeComplexSelector());
         if (check(COMMA)) {
-            values.pop_front();
+            skip();
         }
     }
 
@@ -15,11 +16,12 @@ ComplexSelectorList SelectorParser::parse() {
 }
 
 ComplexSelector SelectorParser::consumeComplexSelector() {
-    ComplexSelector selectors = {{{}, consumeCompoundSelector()}};
+    ComplexSelector selectors;
+    selectors.emplace_back(Combinator(), consumeCompoundSelector());
 
-    while (!values.empty() && !check(T_EOF) && !check(COMMA)) {
+    while (more() && !check(T_EOF) && !check(COMMA)) {
         Combinator comb = consumeCombinator();
-        selectors.emplace_back(comb, consumeCompoundSelector());
+        selectors.emplace_back(std::move(comb), consumeCompoundSelector());
     }
 
     return selectors;
@@ -33,12 +35,12 @@ Combinator SelectorParser::consumeCombinator() {
         case '+':
         case '~': {
             auto temp = std::move(*tok);
-            values.pop_front();
+            skip();
             return temp;
         }
         case '|': {
             auto t1 = std::move(*tok);
-            values.pop_front();
+            skip();
             Token t2 = consume(DELIM, "Expected DELIM");
 
             if (t2.lexeme[0] != '|') {
@@ -60,13 +62,13 @@ CompoundSelector SelectorParser::consumeCompoundSelector() {
         type = consumeTypeSelector();
     }
 
-    vector<SubclassSelector> subclasses;
+    NodeList<SubclassSelector> subclasses;
     bool consuming = true;
 
-    while (consuming && !values.empty()) {
+    while (consuming && more()) {
         if (auto t = peek<Token>()) {
             switch (t->type) {
-                case T_EOF: values.pop_front(); break;
+                case T_EOF: skip(); break;
                 case DELIM: {
                     if (t->lexeme[0] != '.') {
                         consuming = false;
@@ -99,13 +101,16 @@ CompoundSelector SelectorParser::consumeCompoundSelector() {
             if (block && block->open.type == LEFT_BRACKET) {
                 subclasses.emplace_back(consumeSubclassSelector());
             }
+            else {
+                consuming = false;
+            }
         }
     }
-    vector<PseudoSelectorPair> pseudos;
+    NodeList<PseudoSelectorPair> pseudos;
     while (check(COLON)) {
         if (check(COLON, 1)) {
             PseudoElementSelector el = consumePseudoElementSelector();
-            vector<PseudoClassSelector> classes;
+            NodeList<PseudoClassSelector> classes;
 
             while (check(COLON)) {
                 if (!check(COLON, 1)) {
@@ -116,7 +121,7 @@ CompoundSelector SelectorParser::consumeCompoundSelector() {
                 }
             }
 
-            pseudos.emplace_back(el, classes);
+            pseudos.emplace_back(std::move(el), std::move(classes));
         }
         else {
             break;
@@ -127,7 +132,7 @@ CompoundSelector SelectorParser::consumeCompoundSelector() {
         SYNTAX_ERROR("A compound selector requires at least one value. If there is a value at this position, it is most likely invalid.", peek<Token>());
     }
 
-    return CompoundSelector(type, subclasses, pseudos);
+    return CompoundSelector(std::move(type), std::move(subclasses), std::move(pseudos));
 }
 
 AttrMatcher SelectorParser::consumeAttrMatcher() {
@@ -183,7 +188,7 @@ WqName SelectorParser::consumeWqName() {
         }
     
         auto temp = std::move(*t);
-        values.pop_front();
+        skip();
     
         return { nullopt, temp };
     }
@@ -196,11 +201,15 @@ WqName SelectorParser::consumeWqName() {
 }
 
 AttributeSelector SelectorParser::consumeAttributeSelector() {
-    if (auto sb = peek<SimpleBlock>()) {
-        sb->value.insert(sb->value.begin(), sb->open);
-        sb->value.emplace_back(Token(RIGHT_BRACKET, L"]"));
-
-        return SelectorParser(sb->value).consumeAttributeSelector();
+    if (check<SimpleBlock>()) {
+        SimpleBlock sb = consume<SimpleBlock>();
+        NodeList<ComponentValue> tokens;
+        tokens.reserve(sb.value.size() + 2);
+        tokens.emplace_back(std::move(sb.open));
+        std::move(sb.value.begin(), sb.value.end(), std::back_inserter(tokens));
+        tokens.emplace_back(Token(RIGHT_BRACKET, "]"));
+
+        return SelectorParser(std::move(tokens)).consumeAttributeSelector();
     }
     else {
         Token open = consume(LEFT_BRACKET, "Expected [");
@@ -283,7 +292,7 @@ SubclassSelector SelectorParser::consumeSubclassSelector() {
         switch (t->type) {
             case HASH: {
                 auto temp = std::move(*t);
-                values.pop_front();
+                skip();
                 return temp;
             }
             case DELIM: {
@@ -300,16 +309,16 @@ SubclassSelector SelectorParser::consumeSubclassSelector() {
     return { };
 }
 
-vector<ComponentValue> SelectorParser::consumeDeclarationValue(bool any) {
-    vector<ComponentValue> val;
+NodeList<ComponentValue> SelectorParser::consumeDeclarationValue(bool any) {
+    NodeList<ComponentValue> val;
     std::queue<TokenType> opening;
 
-    while (!values.empty()) {
+    while (more()) {
         if (auto t = peek<Token>()) {
             switch (t->type) {
                 case BAD_STRING: case BAD_URL:
                 {
-                    values.pop_front();
+                    skip();
                     return val;
                 }
                 case SEMICOLON: {
@@ -317,8 +326,8 @@ vector<ComponentValue> SelectorParser::consumeDeclarationValue(bool any) {
                         return val;
                     }
 
-                    val.emplace_back(*t);
-                    values.pop_front();
+                    val.emplace_back(std::move(*t));
+                    skip();
                     break;
                 }
                 case DELIM: {
@@ -326,15 +335,15 @@ vector<ComponentValue> SelectorParser::consumeDeclarationValue(bool any) {
                         return val;
                     }
 
-                    val.emplace_back(*t);
-                    values.pop_front();
+                    val.emplace_back(std::move(*t));
+                    skip();
                     break;
                 }
                 case LEFT_PAREN: case LEFT_BRACE: case LEFT_BRACKET:
                 {
                     opening.emplace(t->type);
-                    val.emplace_back(*t);
-                    values.pop_front();
+                    val.emplace_back(std::move(*t));
+                    skip();
                     break;
                 }
                 case RIGHT_PAREN: case RIGHT_BRACE: case RIGHT_BRACKET:
@@ -346,13 +355,13 @@ vector<ComponentValue> SelectorParser::consumeDeclarationValue(bool any) {
                         return val;
                     }
 
-                    val.emplace_back(*t);
-                    values.pop_front();
+                    val.emplace_back(std::move(*t));
+                    skip();
                     break;
                 }
                 default: {
-                    val.emplace_back(*t);
-                    values.pop_front();
+                    val.emplace_back(std::move(*t));
+                    skip();
                     break;
                 }
             }
@@ -369,9 +378,9 @@ PseudoClassSelector SelectorParser::consumePseudoClassSelector() {
 
     if (auto t = peek<Token>()) {
         auto temp = std::move(*t);
-        values.pop_front();
+        skip();
 
-        switch (t->type) {
+        switch (temp.type) {
             case IDENT: return {colon, temp};
             case FUNCTION: return {colon, temp, consumeDeclarationValue(true), consume(RIGHT_PAREN, "Expected closing parenthesis")};
             default: break;
@@ -379,15 +388,15 @@ PseudoClassSelector SelectorParser::consumePseudoClassSelector() {
     }
     else if (auto f = peek<FunctionCall>()) {
         auto temp = std::move(*f);
-        values.pop_front();
-        vector<ComponentValue> any;
+        skip();
+        NodeList<ComponentValue> any;
 
-        for (vector<ComponentValue> arg : temp.arguments) {
+        for (NodeList<ComponentValue>& arg : temp.arguments) {
             std::move(arg.begin(), arg.end(), std::back_inserter(any));
-            any.emplace_back(Token(COMMA, L","));
+            any.emplace_back(Token(COMMA, ","));
         }
 
-        return {colon, temp.name, any, Token(RIGHT_PAREN, L")")};
+        return {colon, temp.name, std::move(any), Token(RIGHT_PAREN, ")")};
     }
 
     SYNTAX_ERROR("Expected identifier or function", peek<Token>());
@@ -0,0 +1,194 @@
+#include <hcss/parser/streamingParser.hpp>
+#include <hcss/parser/blockBuilder.hpp>
+#include <hcss/lexer/structuralIndex.hpp>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * @brief Points the lexeme of 'token' at a copy in 'lexemes'. Equal lexemes share one copy.
+ */
+
+void StreamingParser::keep(Token& token) {
+    if (!token.lexeme.empty()) {
+        token.lexeme = *lexemes.emplace(token.lexeme).first;
+    }
+}
+
+/**
+ * @brief Points every lexeme in 'values' at a copy in 'lexemes', so they no longer depend on the segment they were lexed
+ * @brief from
+ */
+
+void StreamingParser::keep(NodeList<ComponentValue>& values) {
+    for (ComponentValue& value : values) {
+        keep(value);
+    }
+}
+
+void StreamingParser::keep(SimpleBlock& block) {
+    keep(block.open);
+    keep(block.value);
+
+    if (block.close) {
+        keep(*block.close);
+    }
+}
+
+void StreamingParser::keep(ComponentValue& value) {
+    std::visit([this](auto& v) {
+        using T = std::decay_t<decltype(v)>;
+
+        if constexpr (std::is_same_v<T, Token> || std::is_same_v<T, SimpleBlock>) {
+            keep(v);
+        }
+        else if constexpr (std::is_same_v<T, FunctionCall>) {
+            keep(v.name);
+
+            for (auto& argument : v.arguments) {
+                keep(argument);
+            }
+        }
+        else if constexpr (std::is_same_v<T, AtRule>) {
+            keep(v.name);
+            keep(v.prelude);
+
+            if (v.block) {
+                keep(*v.block);
+            }
+        }
+        else if constexpr (std::is_same_v<T, QualifiedRule>) {
+            keep(v.prelude);
+
+            if (v.block) {
+                keep(*v.block);
+            }
+        }
+    }, value);
+}
+
+/**
+ * @brief Parses the whole input, calling 'visit' with each top-level rule in order
+ *
+ * @param visit Receives each rule. The rule and its lexemes are only valid during the call.
+ * @return Throws SyntaxError with its line and column filled in, or std::length_error if the input is too large for
+ * the offset type
+ */
+
+void StreamingParser::parse(const std::function<void(SyntaxNode&)>& visit) {
+    NodeList<SyntaxNode> list;
+    // Started before any work, so the deadline counts from here
+    budget();
+
+    try {
+        while (true) {
+            // Between rules with nothing buffered, no value points into the segments read so far
+            if (remaining() == 0) {
+                release();
+            }
+
+            if (!consumeRule(list)) {
+                break;
+            }
+
+            for (SyntaxNode& rule : list) {
+                resolve(rule, scope);
+                visit(rule);
+            }
+
+            list.clear();
+        }
+    }
+    catch (SyntaxError& e) {
+        for (Segment& segment : segments) {
+            const LineIndex& lines = segment.lexer.lines;
+
+            if (e.offset >= lines.starts.front() && e.offset - lines.starts.front() <= segment.text.size()) {
+                e.locate(lines);
+                break;
+            }
+        }
+
+        throw;
+    }
+}
+
+/**
+ * @brief Reads up to the next top-level rule boundary, then lexes that piece and appends its values
+ *
+ * @return false Once the whole input has been handed out
+ */
+
+bool StreamingParser::pull(NodeList<ComponentValue>& values) {
+    if (finished) {
+        return false;
+    }
+
+    size_t cut = 0;
+
+    while (!exhausted) {
+        // Grow geometrically so a rule larger than a block is not rescanned once per block
+        size_t size = window.size();
+        window.resize(size + std::max(blockSize, size));
+        input.read(window.data() + size, (std::streamsize) (window.size() - size));
+        window.resize(size + input.gcount());
+        exhausted = !input;
+
+        if ((uint64_t) offset + window.size() >= NO_SOURCE_OFFSET) {
+            throw std::length_error("Source is too large for 32-bit offsets. Build with HCSS_LARGE_FILES.");
+        }
+
+        if ((cut = ruleBoundary())) {
+            break;
+        }
+    }
+
+    finished = exhausted && cut == 0;
+    cut = finished ? window.size() : cut;
+
+    Segment& segment = segments.emplace_back(window.substr(0, cut));
+    window.erase(0, cut);
+
+    Lexer& lexer = segment.lexer;
+    lexer.internNames = false;
+    lexer.offsetBase = offset;
+    lexer.lines.starts.front() = offset;
+    lexer.lines.firstLine = line;
+
+    BlockBuilder builder;
+    lexer.lex(builder);
+
+    // Only the last piece ends the input
+    if (!finished) {
+        builder.values.pop_back();
+    }
+
+    values.insert(values.end(), std::make_move_iterator(builder.values.begin()), std::make_move_iterator(builder.values.end()));
+    offset += (SourceOffset) cut;
+    line += (int64_t) lexer.lines.starts.size() - 1;
+    return true;
+}
+
+/**
+ * @return size_t The length of the complete top-level rules at the start of 'window', 0 if there are none yet
+ */
+
+size_t StreamingParser::ruleBoundary() const {
+    StructuralIndex index(window);
+    size_t boundary = 0;
+
+    for (size_t i = 0; (i = index.ruleEnd(i)) < index.size(); i++) {
+        boundary = index.offsets[i] + 1;
+    }
+
+    return boundary;
+}
+
+/**
+ * @brief Frees the segments read so far. What the top-level scope holds was kept when it was defined.
+ */
+
+void StreamingParser::release() {
+    segments.clear();
+}
@@ -1,30 +1,34 @@
 #include <hcss/parser/styleBlockParser.hpp>
 #include <hcss/parser/parser.hpp>
+#include <hcss/parser/clone.hpp>
 #include <hcss/parser/componentValueParser.hpp>
 #include <hcss/parser/selectorParser.hpp>
 #include <hcss/parser/grammar/styleBlock.hpp>
+#include <algorithm>
 #include <iostream>
 
 StyleBlock StyleBlockParser::parse() {
     while (auto t = peek<Token>()) {
         switch (t->type) {
-            case SEMICOLON: values.pop_front(); break;
+            case SEMICOLON: skip(); break;
             case T_EOF: {
-                values.pop_front();
-                return block;
+                skip();
+                return std::move(block);
             }
             case AT_KEYWORD: {
                 auto rule = consumeAtRule();
 
                 if (rule) {
-                    block.emplace_back(*rule);
+                    build(1, &rule->name);
+                    block.emplace_back(std::move(*rule));
                 }
                 break;
             }
             case IDENT: {
-                std::optional<Token> token = peek<Token>(1);
+                auto token = peek<Token>(1);
 
                 if (token && token->type == COLON) {
+                    build(1, t);
                     block.emplace_back(consumeDeclaration());
                     break;
                 }
@@ -32,23 +36,27 @@ StyleBlock StyleBlockParser::parse() {
             case DELIM: {
                 if (t->lexeme[0] == '&') {
                     // TODO: Push this into block
-                    values.pop_front();
+                    skip();
                 }
             }
             default: {
                 auto tok = peek<Token>();
 
                 if (tok && tok->type == SEMICOLON) {
-                    values.pop_front();
+                    skip();
                 }
                 else {
+                    int64_t start = position();
+                    build(1, tok);
                     QualifiedRule rule = consumeQualifiedRule();
 
                     if (rule.block) {
-                        block.emplace_back(StyleRule(SelectorParser(rule.prelude).parse(), StyleBlockParser(rule.block->value).parse()));
+                        StyleBlockParser nested(std::move(rule.block->value));
+                        enter(nested, start);
+                        block.emplace_back(StyleRule(SelectorParser(std::move(rule.prelude)).parse(), nested.parse()));
                     }
                     else {
-                        block.emplace_back(StyleRule(SelectorParser(rule.prelude).parse()));
+                        block.emplace_back(StyleRule(SelectorParser(std::move(rule.prelude)).parse()));
                     }
                 }
 
@@ -56,51 +64,76 @@ StyleBlock StyleBlockParser::parse() {
             }
         }
     }
-    return block;
+    return std::move(block);
 }
 
 optional<AtRule> StyleBlockParser::consumeAtRule() {
-    if (auto rule = Parser::consumeAtRule()) {
-        vector<ComponentValue> mixins;
+    // Where the @include begins, which decides the mixins it is inside of
+    int64_t start = position();
 
-        if (wstrcompi(rule->name.lexeme, L"include")) {
-            ComponentValueParser parser(rule->prelude);
+    if (auto rule = Parser::consumeAtRule()) {
+        if (rule->name.keyword == KW_INCLUDE) {
+            ComponentValueParser parser(std::move(rule->prelude));
+            // Mixins included by name, whose bodies come after those of the mixins called with arguments
+            NodeList<std::pair<Token, Mixin*>> included;
 
-            while (!parser.values.empty()) {
+            while (parser.more()) {
                 if (parser.check(IDENT)) {
                     auto ident = parser.consume<Token>();
 
-                    if (auto mixin = scope.findMixin(ident.lexeme)) {
-                        std::copy(mixin->value.begin(), mixin->value.end(), std::back_inserter(mixins));
+                    if (auto mixin = scope.findMixin(ident.atom())) {
+                        included.emplace_back(std::move(ident), mixin);
                     }
                 }
                 else if (parser.check<FunctionCall>()) {
                     auto call = parser.consume<FunctionCall>();
 
-                    if (auto mixin = scope.findMixin(call.name.lexeme)) {
-                        if (auto func = mixin->function) {
-                            StyleBlockParser sbParser(mixin->value);
+                    if (auto mixin = scope.findMixin(call.name.atom())) {
+                        if (mixin->function) {
+                            include(*mixin, call, start);
+                        }
+                    }
+                }
+
+                if (parser.more()) {
+                    parser.consume(COMMA, "Expected comma");
+                }
+            }
 
-                            for (const auto& [name, value] : func->parameters) {
-                                sbParser.scope.variables[name] = value;
-                            }
+            // Parsed bodies are only copied in if every one of them was parsed, so they keep their order
+            bool parsed = std::all_of(included.begin(), included.end(), [this, start](const auto& mixin) {
+                return !mixin.second->function && compile(*mixin.second, mixin.first, start);
+            });
 
-                            for (int i = 0; i < call.arguments.size(); i++) {
-                                sbParser.scope.variables[func->parameters[i].first] = std::move(call.arguments[i]);
-                            }
+            if (parsed) {
+                for (const auto& [name, mixin] : included) {
+                    build(mixin->body->size(), &name);
 
-                            StyleBlock _block = sbParser.parse();
-                            std::copy(_block.begin(), _block.end(), std::back_inserter(block));
-                        }
+                    for (const StyleBlockVariant& item : *mixin->body) {
+                        block.emplace_back(clone(item));
                     }
                 }
+            }
+            else {
+                NodeList<ComponentValue> mixins;
+                int64_t end = position();
 
-                if (!parser.values.empty()) {
-                    parser.consume(COMMA, "Expected comma");
+                for (const auto& [name, mixin] : included) {
+                    expand(name, start);
+                    spend(countNodes(mixin->value), &name);
+                    NodeList<ComponentValue> copy = clone(mixin->value);
+                    std::move(copy.begin(), copy.end(), std::back_inserter(mixins));
                 }
+
+                // Each body is a region of its own, the last one deepest, since the bodies follow each other
+                for (auto it = included.rbegin(); it != included.rend(); it++) {
+                    regions.push_back({ it->first.atom(), end, it != included.rbegin() });
+                    end -= (int64_t) it->second->value.size();
+                }
+
+                prepend(std::make_move_iterator(mixins.begin()), std::make_move_iterator(mixins.end()));
             }
 
-            std::copy(mixins.rbegin(), mixins.rend(), std::front_inserter(values));
             return nullopt;
         }
 
@@ -110,32 +143,360 @@ optional<AtRule> StyleBlockParser::consumeAtRule() {
     return nullopt;
 }
 
+/**
+ * @brief Appends a key for 'token' to 'key'. Every field but the offset that the token's type uses goes in: a
+ * @brief dimension's lexeme is only its number, so the unit has to be keyed as well.
+ */
+
+static void fingerprint(std::string& key, const Token& token) {
+    uint32_t size = token.lexeme.size();
+    key += (char) token.type;
+    key += token.quote;
+    key += (char) token.flags;
+
+    if (token.isName()) {
+        key.append((const char*) &token.keyword, sizeof(token.keyword));
+    }
+    else if (token.type == NUMBER || token.type == PERCENTAGE || token.type == DIMENSION) {
+        key.append((const char*) &token.unit, sizeof(token.unit));
+        key.append((const char*) &token.value, sizeof(token.value));
+    }
+
+    key.append((const char*) &size, sizeof(size));
+    key += token.lexeme;
+}
+
+/**
+ * @brief Appends a key for 'value' to 'key'. Tokens are keyed by what they read as, not where they are.
+ *
+ * @return False if the value holds a node that has no key, like a rule
+ */
+
+static bool fingerprint(std::string& key, const ComponentValue& value) {
+    if (auto token = std::get_if<Token>(&value)) {
+        fingerprint(key, *token);
+    }
+    else if (auto call = std::get_if<FunctionCall>(&value)) {
+        key += call->unwalked ? '(' : ')';
+        fingerprint(key, call->name);
+
+        for (const auto& argument : call->arguments) {
+            key += ',';
+
+            for (const ComponentValue& item : argument) {
+                if (!fingerprint(key, item)) {
+                    return false;
+                }
+            }
+        }
+
+        key += ')';
+    }
+    else if (auto block = std::get_if<SimpleBlock>(&value)) {
+        key += block->unwalked ? '[' : '{';
+        fingerprint(key, block->open);
+
+        for (const ComponentValue& item : block->value) {
+            if (!fingerprint(key, item)) {
+                return false;
+            }
+        }
+
+        key += block->close ? '}' : ']';
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Adds the body of 'mixin', called as 'call', to the block. The instance only depends on the values its
+ * @brief parameters are bound to, since the body is parsed without the scope around the @include, so it is cached
+ * @brief under a key of those values. An include whose values were seen before copies that instance.
+ *
+ * @param start Where the @include began
+ */
+
+void StyleBlockParser::include(Mixin& mixin, FunctionCall& call, int64_t start) {
+    const FunctionDefinition& func = *mixin.function;
+    // Each parameter's value, defaults first and then the arguments, as a scope would hold them
+    SmallVector<std::pair<Atom, Variable>, 4> arguments;
+
+    auto bind = [&arguments](Atom name, NodeList<ComponentValue> value) {
+        for (auto& [bound, variable] : arguments) {
+            if (bound == name) {
+                variable = Variable(std::move(value));
+                return;
+            }
+        }
+
+        arguments.emplace_back(name, Variable(std::move(value)));
+    };
+
+    for (const auto& [name, value] : func.parameters) {
+        bind(name, clone(value));
+    }
+
+    for (size_t i = 0; i < std::min(call.arguments.size(), func.parameters.size()); i++) {
+        bind(func.parameters[i].first, std::move(call.arguments[i]));
+    }
+
+    std::string key;
+    bool keyed = true;
+
+    for (const auto& [name, variable] : arguments) {
+        for (const ComponentValue& value : variable.values) {
+            keyed = keyed && fingerprint(key, value);
+        }
+
+        key += ';';
+    }
+
+    // Where to keep the instance, if its key has been seen before
+    optional<StyleBlock>* cached = nullptr;
+
+    if (keyed) {
+        auto [it, added] = mixin.instances.try_emplace(std::move(key));
+
+        if (it->second) {
+            mixin.stats.hits++;
+            build(it->second->size(), &call.name);
+
+            for (const StyleBlockVariant& item : *it->second) {
+                block.emplace_back(clone(item));
+            }
+
+            return;
+        }
+
+        if (!added) {
+            cached = &it->second;
+        }
+    }
+
+    // The instance is built from the body and the arguments, so with the arguments kept it outlives this input too
+    if (cached && mixin.store) {
+        for (auto& [name, variable] : arguments) {
+            mixin.store->keep(variable.values);
+        }
+    }
+
+    mixin.stats.misses++;
+    size_t first = block.size();
+
+    if (!compile(mixin, call.name, start) || !instantiate(mixin, arguments)) {
+        StyleBlockParser sbParser(clone(mixin.value));
+        enter(sbParser, start, &call.name);
+
+        for (auto& [name, variable] : arguments) {
+            sbParser.scope.defineVariable(name, std::move(variable.values));
+        }
+
+        StyleBlock _block = sbParser.parse();
+        std::move(_block.begin(), _block.end(), std::back_inserter(block));
+    }
+
+    if (cached) {
+        StyleBlock instance;
+        instance.reserve(block.size() - first);
+
+        for (size_t i = first; i < block.size(); i++) {
+            instance.emplace_back(clone(block[i]));
+        }
+
+        *cached = std::move(instance);
+    }
+}
+
+/**
+ * @brief Whether values[i] and values[i + 1] are a '$' and the name after it, as a parameter reference is left in a
+ * @brief parsed body
+ */
+
+static bool isReference(const SmallVector<ComponentValue, 2>& values, size_t i) {
+    if (i + 1 >= values.size()) {
+        return false;
+    }
+
+    auto dollar = std::get_if<Token>(&values[i]);
+    auto name = std::get_if<Token>(&values[i + 1]);
+    return dollar && name && dollar->type == DELIM && dollar->lexeme[0] == '$' && name->type == IDENT;
+}
+
+/**
+ * @brief Parses the body of 'mixin' into 'mixin.body' the first time it is included. The parse is kept only if it
+ * @brief comes out the same wherever the mixin is included. For a mixin with parameters, every parameter reference must
+ * @brief be in a declaration's value, where an include just puts the argument in its place. A mixin included by name is
+ * @brief parsed along with the block around the @include, so its body must hold no at-rules, which could define or
+ * @brief look up names in that block, and must end its last statement itself.
+ *
+ * @param name, start The name of the mixin in the @include that included it first, and where that @include began
+ * @return Whether 'mixin.body' holds the parsed body
+ */
+
+bool StyleBlockParser::compile(Mixin& mixin, const Token& name, int64_t start) {
+    if (mixin.compiled) {
+        return mixin.body.has_value();
+    }
+
+    mixin.compiled = true;
+
+    if (!mixin.function) {
+        for (const ComponentValue& value : mixin.value) {
+            auto token = std::get_if<Token>(&value);
+
+            if (token && (token->type == AT_KEYWORD || token->type == T_EOF)) {
+                return false;
+            }
+        }
+    }
+
+    StyleBlockParser parser(clone(mixin.value));
+    enter(parser, start, &name);
+    StyleBlock body;
+
+    if (mixin.function) {
+        for (const auto& [name, value] : mixin.function->parameters) {
+            parser.scope.addParameter(name);
+        }
+    }
+
+    try {
+        body = parser.parse();
+    }
+    catch (const ExpansionError&) {
+        throw;
+    }
+    catch (const SyntaxError&) {
+        // Left to the include, which reports it as it always has
+        return false;
+    }
+
+    if (parser.more()) {
+        return false;
+    }
+
+    if (!mixin.function && !mixin.value.empty()) {
+        auto token = std::get_if<Token>(&mixin.value.back());
+        bool ended = token ? token->type == SEMICOLON : !body.empty() && std::holds_alternative<StyleRule>(body.back());
+
+        if (!ended) {
+            return false;
+        }
+    }
+
+    uint32_t references = 0;
+
+    for (const StyleBlockVariant& item : body) {
+        if (auto dec = std::get_if<Declaration>(&item)) {
+            for (size_t i = 0; i < dec->value.size(); i++) {
+                if (isReference(dec->value, i)) {
+                    references++;
+                }
+            }
+        }
+    }
+
+    // A reference anywhere else, like a selector or an at-rule's prelude, would have been replaced before parsing it
+    if (references != parser.parameterReferences) {
+        return false;
+    }
+
+    mixin.body = std::move(body);
+    return true;
+}
+
+/**
+ * @brief Adds a copy of the parsed body of 'mixin' to the block, with each parameter reference replaced by the values
+ * @brief in 'arguments'
+ *
+ * @return False if an argument would not be copied as-is when parsing the body, in which case nothing is added
+ */
+
+bool StyleBlockParser::instantiate(const Mixin& mixin, SmallVector<std::pair<Atom, Variable>, 4>& arguments) {
+    for (const auto& [name, variable] : arguments) {
+        if (!variable.flat) {
+            return false;
+        }
+    }
+
+    build(mixin.body->size(), nullptr);
+    block.reserve(block.size() + mixin.body->size());
+
+    for (const StyleBlockVariant& item : *mixin.body) {
+        auto dec = std::get_if<Declaration>(&item);
+        bool references = false;
+
+        for (size_t i = 0; dec && i < dec->value.size() && !references; i++) {
+            references = isReference(dec->value, i);
+        }
+
+        if (!references) {
+            block.emplace_back(clone(item));
+            continue;
+        }
+
+        Declaration copy(dec->name, dec->colon, {}, dec->important);
+
+        for (size_t i = 0; i < dec->value.size(); i++) {
+            if (isReference(dec->value, i)) {
+                Atom name = std::get<Token>(dec->value[++i]).atom();
+
+                for (const auto& [bound, variable] : arguments) {
+                    if (bound == name) {
+                        for (const ComponentValue& value : variable.values) {
+                            copy.value.emplace_back(clone(value));
+                        }
+                    }
+                }
+            }
+            else {
+                copy.value.emplace_back(clone(dec->value[i]));
+            }
+        }
+
+        trimImportant(copy);
+        block.emplace_back(std::move(copy));
+    }
+
+    return true;
+}
+
 Declaration StyleBlockParser::consumeDeclaration() {
     Token name = consume(IDENT, "Expected identifier");
     Token colon = consume(COLON, "Expected colon");
     Declaration dec(name, colon);
 
-    while (!values.empty()) {
+    while (more()) {
         auto tok = peek<Token>();
 
         if (tok && tok->type == SEMICOLON) {
-            values.pop_front();
+            skip();
             break;
         }
     
         consumeComponentValue(dec.value);
     }
 
+    trimImportant(dec);
+    return dec;
+}
+
+/**
+ * @brief Removes a trailing '!important' from the declaration's value
+ */
+
+void StyleBlockParser::trimImportant(Declaration& dec) {
     if (dec.value.size() > 1) {
         if (auto t1 = std::get_if<Token>(&dec.value.back())) {
             if (auto t2 = std::get_if<Token>(&dec.value[dec.value.size() - 2])) {
-                if (t1->type == DELIM && t1->lexeme[0] == L'!' && t2->type == IDENT && wstrcompi(t2->lexeme, L"important")) {
+                if (t1->type == DELIM && t1->lexeme[0] == '!' && t2->type == IDENT && t2->keyword == KW_IMPORTANT) {
                     dec.value.pop_back();
                     dec.value.pop_back();
                 }
             }
         }
     }
-
-    return dec;
-}
\ No newline at end of file
+}
@@ -0,0 +1,59 @@
+#include <hcss/parser/stylesheet.hpp>
+#include <hcss/parser/blockBuilder.hpp>
+
+/**
+ * @brief Parses 'source' into the arena, replacing the previous rules. 'source' is copied, so it does not have to
+ * outlive the sheet.
+ *
+ * @return NodeList<SyntaxNode>& The parsed rules
+ * @return Throws SyntaxError with its line and column filled in, ExpansionError if the sheet runs over its limits
+ */
+
+NodeList<SyntaxNode>& Stylesheet::parse(std::string_view source) {
+    reset();
+    ArenaScope scope(arena);
+
+    lexer.emplace(arena.copy(source));
+
+    try {
+        BlockBuilder builder;
+        lexer->lex(builder);
+        Parser parser(std::move(builder.values));
+        parser.limits = limits;
+        parser.pool = pool;
+        parser.arenas = &workers;
+        list = arena.create<NodeList<SyntaxNode>>(parser.parse());
+        includes = parser.includeStats();
+    }
+    catch (SyntaxError& e) {
+        e.locate(lexer->lines);
+        throw;
+    }
+
+    return *list;
+}
+
+/**
+ * @brief Drops the rules and rewinds the arenas. The syntax tree is not walked: its memory all belongs to the arenas.
+ */
+
+void Stylesheet::reset() {
+    list = nullptr;
+    includes = {};
+    lexer.reset();
+    arena.reset();
+
+    for (Arena& worker : workers) {
+        worker.reset();
+    }
+}
+
+size_t Stylesheet::capacity() const {
+    size_t bytes = arena.capacity();
+
+    for (const Arena& worker : workers) {
+        bytes += worker.capacity();
+    }
+
+    return bytes;
+}
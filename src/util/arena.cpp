@@ -0,0 +1,232 @@
+#include <hcss/util/arena.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+thread_local Arena* Arena::active = nullptr;
+
+Arena::~Arena() {
+    for (Block& block : blocks) {
+        ::operator delete(block.data);
+    }
+}
+
+/**
+ * @return size_t 'size' rounded up to a whole number of grains, the size an allocation of 'size' bytes takes up
+ */
+
+static std::size_t slotSize(std::size_t size, std::size_t grain) {
+    return (std::max(size, sizeof(void*)) + grain - 1) & ~(grain - 1);
+}
+
+// The header of a freed large slot
+struct LargeSlot {
+    std::size_t size;
+    char* next;
+};
+
+static LargeSlot& header(char* slot) {
+    return *(LargeSlot*) slot;
+}
+
+/**
+ * @return size_t The list of largeFree that slots of 'size' bytes go on. There are four per power of two.
+ */
+
+static std::size_t largeList(std::size_t size) {
+    std::size_t power = std::bit_width(size) - 1;
+    return power * 4 + ((size >> (power - 2)) & 3);
+}
+
+/**
+ * @brief Allocates 'size' bytes aligned to 'align', a power of two. Reuses freed memory of the same size first.
+ */
+
+void* Arena::allocate(std::size_t size, std::size_t align) {
+    if (align > GRAIN) {
+        return bump(size, align);
+    }
+
+    if (size > SMALL_SIZE) {
+        return allocateLarge(size);
+    }
+
+    size = slotSize(size, GRAIN);
+    void*& head = freeLists[size / GRAIN];
+
+    if (void* p = head) {
+        head = *(void**) p;
+        return p;
+    }
+
+    return allocateSmall(size);
+}
+
+/**
+ * @brief Allocates a new small slot of 'size' bytes, a multiple of GRAIN. It is carved from a freed large slot if there
+ * @brief is one, so the memory of large temporaries is not left idle while the arena grows.
+ */
+
+void* Arena::allocateSmall(std::size_t size) {
+    if (carveEnd - carvePos < (std::ptrdiff_t) size && largeFreeCount) {
+        // From the largest list, so carving moves to a new slot as rarely as possible. The rest of the old one is given up.
+        for (std::size_t i = largeFree.size(); i-- > largeList(SMALL_SIZE);) {
+            if (char* slot = largeFree[i]) {
+                largeFree[i] = header(slot).next;
+                largeFreeCount--;
+                carvePos = slot;
+                carveEnd = slot + header(slot).size;
+                break;
+            }
+        }
+    }
+
+    if (carveEnd - carvePos >= (std::ptrdiff_t) size) {
+        char* p = carvePos;
+        carvePos += size;
+        return p;
+    }
+
+    return bump(size, GRAIN);
+}
+
+/**
+ * @brief Allocates more than SMALL_SIZE bytes from a freed slot that fits, or bumps a new one
+ */
+
+void* Arena::allocateLarge(std::size_t size) {
+    size = slotSize(size, GRAIN) + GRAIN;
+    char* slot = takeLarge(size);
+
+    if (!slot) {
+        slot = bump(size, GRAIN);
+        header(slot).size = size;
+    }
+
+    return slot + GRAIN;
+}
+
+/**
+ * @brief Takes a freed large slot of at least 'size' bytes off its list. Only the first few slots of the list that may
+ * @brief be too small are looked at; every slot on a higher list fits.
+ *
+ * @return char* The slot, nullptr if there is none
+ */
+
+char* Arena::takeLarge(std::size_t size) {
+    std::size_t first = largeList(size);
+    char** link = &largeFree[first];
+
+    for (int i = 0; *link && i < 8; i++, link = &header(*link).next) {
+        if (header(*link).size >= size) {
+            char* slot = *link;
+            *link = header(slot).next;
+            largeFreeCount--;
+            return slot;
+        }
+    }
+
+    for (std::size_t i = first + 1; largeFreeCount && i < largeFree.size(); i++) {
+        if (char* slot = largeFree[i]) {
+            largeFree[i] = header(slot).next;
+            largeFreeCount--;
+            return slot;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Puts memory from allocate() on its free list. Over-aligned memory is only reclaimed by reset().
+ */
+
+void Arena::deallocate(void* p, std::size_t size, std::size_t align) {
+    if (!p || align > GRAIN) {
+        return;
+    }
+
+    if (size > SMALL_SIZE) {
+        char* slot = (char*) p - GRAIN;
+        char*& head = largeFree[largeList(header(slot).size)];
+        header(slot).next = head;
+        head = slot;
+        largeFreeCount++;
+        return;
+    }
+
+    void*& head = freeLists[slotSize(size, GRAIN) / GRAIN];
+    *(void**) p = head;
+    head = p;
+}
+
+/**
+ * @brief Copies 'text' into the arena without rounding its size
+ */
+
+std::string_view Arena::copy(std::string_view text) {
+    char* p = bump(text.size(), 1);
+    std::memcpy(p, text.data(), text.size());
+    return { p, text.size() };
+}
+
+char* Arena::bump(std::size_t size, std::size_t align) {
+    auto p = (char*) (((std::uintptr_t) pos + align - 1) & ~(std::uintptr_t) (align - 1));
+
+    if (!pos || p + size > end) {
+        grow(size + align);
+        p = (char*) (((std::uintptr_t) pos + align - 1) & ~(std::uintptr_t) (align - 1));
+    }
+
+    pos = p + size;
+    return p;
+}
+
+/**
+ * @brief Starts a new block with room for at least 'size' bytes. Each block is at least as large as all the earlier ones
+ * @brief together, so a big parse needs few blocks. The rest of the previous block is given up.
+ */
+
+void Arena::grow(std::size_t size) {
+    std::size_t bytes = std::max({ size, blockSize, capacity() });
+    blocks.push_back({ (char*) ::operator new(bytes), bytes });
+    pos = blocks.back().data;
+    end = pos + bytes;
+}
+
+/**
+ * @brief Drops everything in the arena but keeps its memory for the next use. If it took several blocks, they are
+ * @brief replaced by a single one as large as all of them, so the same workload fits without growing again.
+ */
+
+void Arena::reset() {
+    freeLists = {};
+    largeFree = {};
+    largeFreeCount = 0;
+    carvePos = carveEnd = nullptr;
+
+    if (blocks.size() > 1) {
+        std::size_t bytes = capacity();
+
+        for (Block& block : blocks) {
+            ::operator delete(block.data);
+        }
+
+        blocks.clear();
+        blocks.push_back({ (char*) ::operator new(bytes), bytes });
+    }
+
+    pos = blocks.empty() ? nullptr : blocks.front().data;
+    end = blocks.empty() ? nullptr : pos + blocks.front().size;
+}
+
+std::size_t Arena::capacity() const {
+    std::size_t bytes = 0;
+
+    for (const Block& block : blocks) {
+        bytes += block.size;
+    }
+
+    return bytes;
+}
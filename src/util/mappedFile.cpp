@@ -0,0 +1,70 @@
+#include <hcss/util/mappedFile.hpp>
+#include <system_error>
+#include <utility>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Maps 'path' into memory read-only
+ *
+ * @param path The file to map
+ * @return Throws std::system_error if the file cannot be opened or mapped
+ */
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Could not open " + path);
+    }
+
+    struct stat info {};
+
+    if (fstat(fd, &info) < 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Could not stat " + path);
+    }
+
+    length = (std::size_t) info.st_size;
+
+    // mmap rejects zero-length mappings, an empty file is just an empty view
+    if (length > 0) {
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Could not map " + path);
+        }
+
+        madvise(mapping, length, MADV_SEQUENTIAL);
+        ptr = static_cast<const char*>(mapping);
+    }
+
+    close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : ptr(std::exchange(other.ptr, nullptr)),
+    length(std::exchange(other.length, 0))
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        this->~MappedFile();
+        ptr = std::exchange(other.ptr, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    if (ptr) {
+        munmap(const_cast<char*>(ptr), length);
+    }
+}
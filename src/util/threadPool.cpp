@@ -0,0 +1,48 @@
+#include <hcss/util/threadPool.hpp>
+
+ThreadPool::ThreadPool(unsigned threads) {
+    threads = threads ? threads : 1;
+    workers.reserve(threads);
+
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(lock);
+        stopping = true;
+    }
+
+    ready.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> job;
+
+        {
+            std::unique_lock guard(lock);
+            ready.wait(guard, [this] { return stopping || !queue.empty(); });
+
+            if (queue.empty()) {
+                return;
+            }
+
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        job();
+    }
+}
@@ -1,10 +1,40 @@
 #include <hcss/util/util.hpp>
+#include <algorithm>
 
-bool wstrcompi(std::wstring str1, std::wstring str2) {
+/**
+ * @brief Compares two UTF-8 strings, folding ASCII letters only. CSS keywords are ASCII case-insensitive.
+ */
+
+bool strcompi(std::string_view str1, std::string_view str2) {
 	if (str1.length() == str2.length()) {
 		return std::equal(str2.begin(), str2.end(),
-			str1.begin(), [](wchar_t a, wchar_t b)->bool { return std::tolower(a) == std::tolower(b); });
+			str1.begin(), [](char a, char b)->bool { return (a >= 'A' && a <= 'Z' ? a | 0x20 : a) == (b >= 'A' && b <= 'Z' ? b | 0x20 : b); });
 	}
 
 	return false;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Appends the UTF-8 encoding of 'codePoint' to 'str'
+ */
+
+void appendUtf8(std::string& str, char32_t codePoint) {
+	if (codePoint < 0x80) {
+		str += (char) codePoint;
+	}
+	else if (codePoint < 0x800) {
+		str += (char) (0xC0 | (codePoint >> 6));
+		str += (char) (0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000) {
+		str += (char) (0xE0 | (codePoint >> 12));
+		str += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+		str += (char) (0x80 | (codePoint & 0x3F));
+	}
+	else {
+		str += (char) (0xF0 | (codePoint >> 18));
+		str += (char) (0x80 | ((codePoint >> 12) & 0x3F));
+		str += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+		str += (char) (0x80 | (codePoint & 0x3F));
+	}
+}
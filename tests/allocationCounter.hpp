@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counts calls to the global operator new. Linking allocationCounter.cpp into a program replaces the operators, so only
+ * link it into the test and benchmark programs.
+ */
+
+uint64_t allocationCount();
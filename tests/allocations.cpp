@@ -0,0 +1,60 @@
+#include "allocationCounter.hpp"
+#include <hcss/lexer/lexer.hpp>
+#include <hcss/parser/blockBuilder.hpp>
+#include <hcss/parser/parser.hpp>
+#include <hcss/parser/stylesheet.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+/**
+ * Parses a reference sheet through Parser and through Stylesheet and fails if either makes more global allocations than
+ * it did when the ceilings below were recorded. Lower a ceiling when a change brings its count down.
+ *
+ *   allocations tests/reference.css
+ */
+
+constexpr uint64_t PARSER_CEILING = 383;
+constexpr uint64_t STYLESHEET_CEILING = 103;
+constexpr uint64_t STYLESHEET_REUSE_CEILING = 97;
+
+static bool check(const char* name, uint64_t count, uint64_t ceiling) {
+    std::cout << name << ": " << count << " allocations (ceiling " << ceiling << ")\n";
+    return count <= ceiling;
+}
+
+int main(int argc, char** argv) {
+    std::ifstream file(argc > 1 ? argv[1] : "tests/reference.css", std::ios::binary);
+    std::string source(std::istreambuf_iterator<char>(file), {});
+
+    if (source.empty()) {
+        std::cerr << "Could not read the reference sheet\n";
+        return 1;
+    }
+
+    bool passed = true;
+    uint64_t before = allocationCount();
+
+    {
+        Lexer lexer(source);
+        BlockBuilder builder;
+        lexer.lex(builder);
+        Parser parser(std::move(builder.values));
+        parser.parse();
+    }
+
+    passed &= check("Parser", allocationCount() - before, PARSER_CEILING);
+
+    Stylesheet sheet;
+    before = allocationCount();
+    sheet.parse(source);
+    passed &= check("Stylesheet", allocationCount() - before, STYLESHEET_CEILING);
+
+    // A second parse reuses the arena, so it should only allocate what does not live in it
+    sheet.reset();
+    before = allocationCount();
+    sheet.parse(source);
+    passed &= check("Stylesheet after reset", allocationCount() - before, STYLESHEET_REUSE_CEILING);
+
+    return passed ? 0 : 1;
+}
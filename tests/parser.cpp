@@ -0,0 +1,151 @@
+#include <hcss/lexer/lexer.hpp>
+#include <hcss/lexer/unit.hpp>
+#include <hcss/parser/blockBuilder.hpp>
+#include <hcss/parser/stylesheet.hpp>
+#include <hcss/util/threadPool.hpp>
+#include <sys/resource.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/**
+ * Parses small sheets through Stylesheet and checks what they compile to. Prints each failed check and exits with 1 if
+ * there was one.
+ *
+ *   parser
+ */
+
+static int failures = 0;
+
+static void expect(bool passed, const std::string& what) {
+    if (!passed) {
+        std::cout << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+/**
+ * @return std::string The value of the first declaration of top-level rule 'index', each token as its lexeme and unit
+ */
+
+static std::string declaration(NodeList<SyntaxNode>& rules, size_t index) {
+    std::string text;
+
+    if (index >= rules.size()) {
+        return text;
+    }
+
+    auto rule = std::get_if<StyleRule>(&rules[index]);
+
+    if (!rule || rule->block.empty()) {
+        return text;
+    }
+
+    auto declaration = std::get_if<Declaration>(&rule->block.front());
+
+    if (!declaration) {
+        return text;
+    }
+
+    for (const ComponentValue& value : declaration->value) {
+        if (auto token = std::get_if<Token>(&value)) {
+            text += std::string(token->lexeme) + std::string(unitName(token->unit));
+        }
+    }
+
+    return text;
+}
+
+// The instance cache keys a dimension by its unit as well as its number. An instance is kept once its values come a
+// second time, so the third include of each is the one that reads the cache.
+static void mixinInstancesByUnit() {
+    Stylesheet sheet;
+    NodeList<SyntaxNode>& rules = sheet.parse(
+        "@mixin w($x) { width: $x; }\n"
+        ".a { @include w(5px); }\n.b { @include w(5px); }\n.c { @include w(5px); }\n"
+        ".d { @include w(5em); }\n.e { @include w(5em); }\n.f { @include w(5em); }\n"
+    );
+
+    expect(sheet.includeStats().hits == 2, "the mixin instance cache is hit once per unit");
+
+    for (size_t i = 0; i < 6; i++) {
+        expect(declaration(rules, i) == (i < 3 ? "5px" : "5em"), "include " + std::to_string(i) + " keeps its unit");
+    }
+}
+
+// Variables that each double the one before run into the default ExpansionLimits fast, before they take much memory
+static void doublingVariables() {
+    std::string source = "$a0: x;\n";
+
+    for (int i = 1; i < 60; i++) {
+        source += "$a" + std::to_string(i) + ": $a" + std::to_string(i - 1) + " $a" + std::to_string(i - 1) + ";\n";
+    }
+
+    source += ".a { b: $a59; }\n";
+    auto start = std::chrono::steady_clock::now();
+    bool stopped = false;
+
+    try {
+        Stylesheet sheet;
+        sheet.parse(source);
+    }
+    catch (const ExpansionError&) {
+        stopped = true;
+    }
+
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    expect(stopped, "a doubling sheet of " + std::to_string(source.size()) + " bytes throws ExpansionError");
+    expect(seconds < 5, "the doubling sheet stops within 5 s, took " + std::to_string(seconds));
+    expect(usage.ru_maxrss < 512 * 1024, "the doubling sheet stays under 512 MB, peaked at " + std::to_string(usage.ru_maxrss / 1024) + " MB");
+}
+
+/**
+ * @return bool Whether Parser turned down a pool under an arena with no Parser::arenas for a sheet of 'rules' rules
+ */
+
+static bool poolRejected(size_t rules, ThreadPool& pool) {
+    std::string source;
+
+    for (size_t i = 0; i < rules; i++) {
+        source += ".r" + std::to_string(i) + " { x: 1; }\n";
+    }
+
+    Arena arena;
+    ArenaScope scope(arena);
+    Lexer lexer(source);
+    BlockBuilder builder;
+    lexer.lex(builder);
+    Parser parser(std::move(builder.values));
+    parser.pool = &pool;
+
+    try {
+        parser.parse();
+    }
+    catch (const std::invalid_argument&) {
+        return true;
+    }
+
+    return false;
+}
+
+// A pool under an arena needs Parser::arenas, but only for sheets large enough to be resolved on it
+static void poolUnderArena() {
+    ThreadPool pool(2);
+    expect(!poolRejected(10, pool), "a small sheet parses serially under an arena without Parser::arenas");
+    expect(poolRejected(1000, pool), "a large sheet under an arena without Parser::arenas is rejected");
+}
+
+int main() {
+    mixinInstancesByUnit();
+    doublingVariables();
+    poolUnderArena();
+
+    if (!failures) {
+        std::cout << "All parser checks passed\n";
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+#include <hcss/lexer/lexer.hpp>
+#include <hcss/parser/blockBuilder.hpp>
+#include <hcss/parser/streamingParser.hpp>
+#include <sys/resource.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+/**
+ * Checks that StreamingParser parses like Parser, keeps its definitions and mixin instances across pieces of input, and
+ * stays in bounded memory on a large sheet where every class name is different. Prints each failed check and exits with
+ * 1 if there was one.
+ *
+ *   streaming
+ */
+
+static int failures = 0;
+
+static void expect(bool passed, const std::string& what) {
+    if (!passed) {
+        std::cout << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+/**
+ * @brief Generates rules as they are read, so the input does not have to be held in memory to be parsed
+ */
+
+class RuleStream : public std::streambuf {
+    public:
+        RuleStream(const std::string& header, size_t rules, std::string (*rule)(size_t))
+            : pending(header), rules(rules), rule(rule)
+        {};
+    protected:
+        int_type underflow() override {
+            if (next == rules && pending.empty()) {
+                return traits_type::eof();
+            }
+
+            if (pending.empty()) {
+                pending = rule(next++);
+            }
+
+            current.swap(pending);
+            pending.clear();
+            setg(current.data(), current.data(), current.data() + current.size());
+            return traits_type::to_int_type(current[0]);
+        }
+    private:
+        std::string current;
+        std::string pending;
+        size_t next = 0;
+        size_t rules;
+        std::string (*rule)(size_t);
+};
+
+static const char* HEADER =
+    "$color: #336699;\n@tablet = screen and (min-width: 768px);\n"
+    "@mixin w($x, $y: auto) { width: $x; height: $y; }\n@mixin reset { margin: 0; padding: 0; }\n";
+
+static std::string mixed(size_t i) {
+    switch (i % 4) {
+        case 0: return ".a" + std::to_string(i) + " { color: $color; @include w(" + std::to_string(i % 3) + "px); }\n";
+        case 1: return ".b" + std::to_string(i) + " { @include reset; }\n";
+        case 2: return "@tablet { .c" + std::to_string(i) + " { color: red; } }\n";
+        default: return "$color: #" + std::to_string(100000 + i % 7) + ";\n";
+    }
+}
+
+static std::string unique(size_t i) {
+    return ".unique-class-name-" + std::to_string(i) + " > .another-unique-name-" + std::to_string(i) + " { color: red; }\n";
+}
+
+/**
+ * @return std::string Each rule's type and its number of style block items, and the lexemes of its declarations
+ */
+
+static void describe(std::ostream& out, const SyntaxNode& rule) {
+    out << rule.index();
+
+    if (auto style = std::get_if<StyleRule>(&rule)) {
+        for (const StyleBlockVariant& item : style->block) {
+            if (auto dec = std::get_if<Declaration>(&item)) {
+                out << ' ' << dec->name.lexeme << ':';
+
+                for (const ComponentValue& value : dec->value) {
+                    if (auto token = std::get_if<Token>(&value)) {
+                        out << token->lexeme;
+                    }
+                }
+            }
+        }
+    }
+
+    out << '\n';
+}
+
+// Small pieces, so definitions, compiled mixin bodies and instances have to outlive many of them
+static void matchesParser() {
+    std::string source = HEADER;
+
+    for (size_t i = 0; i < 2000; i++) {
+        source += mixed(i);
+    }
+
+    std::ostringstream whole, streamed;
+    Lexer lexer(source);
+    BlockBuilder builder;
+    lexer.lex(builder);
+    Parser parser(std::move(builder.values));
+
+    for (const SyntaxNode& rule : parser.parse()) {
+        describe(whole, rule);
+    }
+
+    std::istringstream input(source);
+    StreamingParser streaming(input, 256);
+    streaming.parse([&streamed](SyntaxNode& rule) { describe(streamed, rule); });
+
+    expect(whole.str() == streamed.str(), "streaming parses like Parser");
+    expect(streaming.includeStats().hits >= 490, "mixin instances outlive the input they were built from, " + std::to_string(streaming.includeStats().hits) + " hits");
+}
+
+/**
+ * @return long The peak resident size of the process in MB after streaming 'rules' rules of unique class names
+ */
+
+static long streamUnique(size_t rules) {
+    RuleStream generated("", rules, unique);
+    std::istream input(&generated);
+    StreamingParser streaming(input);
+    size_t parsed = 0;
+    streaming.parse([&parsed](SyntaxNode&) { parsed++; });
+    expect(parsed == rules, "all " + std::to_string(rules) + " rules are parsed");
+
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+}
+
+// Names that never repeat must not pile up anywhere, so 50 MB of them peaks about where 6 MB of them did
+static void uniqueNames() {
+    long small = streamUnique(75000);
+    long large = streamUnique(600000);
+    expect(large - small < 16, "unique names do not grow memory, peaked at " + std::to_string(small) + " MB then " + std::to_string(large) + " MB");
+}
+
+int main() {
+    uniqueNames();
+    matchesParser();
+
+    if (!failures) {
+        std::cout << "All streaming checks passed\n";
+    }
+
+    return failures ? 1 : 0;
+}